@@ -23,9 +23,19 @@
 
 #include <inttypes.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <list>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 #include "imgui.h"
@@ -40,23 +50,52 @@ namespace imlottie {
     uint16_t animationTotalFrame(const std::shared_ptr<imlottie::Animation> &anim);
     double animationDuration(const std::shared_ptr<imlottie::Animation> &anim);
     void animationRenderSync(const std::shared_ptr<imlottie::Animation> &anim, int nextFrameIndex, uint32_t *data, int width, int height, int row_pitch);
+    bool animationRenderRetained(const std::shared_ptr<imlottie::Animation> &anim, int nextFrameIndex, uint32_t *data, int width, int height, int row_pitch,
+                                 int &dirtyX, int &dirtyY, int &dirtyW, int &dirtyH);
+    void configureModelCacheSize(size_t cacheSize);
+    void modelCacheStats(size_t &hits, size_t &misses, size_t &entries);
+    void imageCacheStats(size_t &bytes, size_t &entries, size_t &decoded);
+    void gradientCacheStats(size_t &hits, size_t &misses, size_t &builds);
+    void shutdownRasterThreads();
+    // empty / false unless renderer is built with IMLOTTIE_TRACE
+    std::string traceSummary();
+    bool traceExport(const std::string &path);
 }
 
 namespace ImLottie {
 
 constexpr ImGuiID BAD_PICTUREID = ImGuiID(-1);
+// render thread has nothing to wait for except new commands
+constexpr uint32_t NO_WAKEUP = uint32_t(-1);
 
-// Data in system memory where saved frame
-struct NextFrame {
-    std::vector<uint8_t> data;
-    ImVec2 size;
+// Part of the canvas that differs from the previous frame of the same animation
+struct DirtyRect {
+    int x = 0, y = 0, w = 0, h = 0;
+
+    bool empty() const { return w <= 0 || h <= 0; }
+
+    void unite(const DirtyRect &r) {
+        if (r.empty())
+            return;
+        if (empty()) {
+            *this = r;
+            return;
+        }
+        int right = std::max(x + w, r.x + r.w);
+        int bottom = std::max(y + h, r.y + r.h);
+        x = std::min(x, r.x);
+        y = std::min(y, r.y);
+        w = right - x;
+        h = bottom - y;
+    }
 };
 
 // Data in system memory, this frame ready for move to tmp atlas
 struct ReadyFrame {
-    ImGuiID pid = BAD_PICTUREID;
     std::vector<uint8_t> data;
     ImVec2 size;
+    // only this area needs to reach the texture, data holds the whole frame
+    DirtyRect dirty;
 #if DEBUG_LOTTIE_UPDATE
     const char *lottie = nullptr;
     int frame = 0;
@@ -64,6 +103,229 @@ struct ReadyFrame {
 #endif
 };
 
+// Frame slots of one animation, storage of slot is allocated on first use
+// and reused after. Render thread writes frames ahead (prerendered) and
+// publishes them when their time comes, main thread takes published ones.
+// Single producer, single consumer, indices only grow, slot is index % size.
+struct LottieFrameRing {
+    explicit LottieFrameRing(size_t capacity) : slots(capacity) {}
+
+    // render thread side
+
+    // free slot for next prerendered frame, null when ring is full
+    ReadyFrame *beginWrite() {
+        if (writeIdx - readIdx.load(std::memory_order_acquire) >= slots.size()) {
+            return nullptr;
+        }
+        return &slots[writeIdx % slots.size()];
+    }
+
+    void endWrite() { writeIdx++; }
+
+    size_t prerendered() const { return writeIdx - publishIdx.load(std::memory_order_relaxed); }
+
+    bool full() const { return writeIdx - readIdx.load(std::memory_order_acquire) >= slots.size(); }
+
+    // oldest prerendered frame goes to main thread
+    bool publish() {
+        size_t published = publishIdx.load(std::memory_order_relaxed);
+        if (published == writeIdx) {
+            return false;
+        }
+        publishIdx.store(published + 1, std::memory_order_release);
+        return true;
+    }
+
+    // main thread side
+
+    size_t readable() const { return publishIdx.load(std::memory_order_acquire) - readIdx.load(std::memory_order_relaxed); }
+
+    // i-th published frame from oldest, i < readable()
+    const ReadyFrame &at(size_t i) const { return slots[(readIdx.load(std::memory_order_relaxed) + i) % slots.size()]; }
+
+    // count frames are taken, their slots go back to render thread
+    void release(size_t count) { readIdx.store(readIdx.load(std::memory_order_relaxed) + count, std::memory_order_release); }
+
+private:
+    std::vector<ReadyFrame> slots;
+    size_t writeIdx = 0;
+    std::atomic<size_t> publishIdx{0};
+    std::atomic<size_t> readIdx{0};
+};
+
+// Pixels of frame area packed row by row. Word with RUN bit is followed by
+// one pixel repeated (word & ~RUN) times, without it by that many pixels as is.
+struct LottieBakedFrame {
+    static constexpr uint32_t RUN = 0x80000000u;
+    // shorter runs cost more as run than as pixels
+    static constexpr int MIN_RUN = 3;
+
+    DirtyRect rect;
+    std::vector<uint32_t> words;
+
+    // stride - pixels per row of canvas
+    void encode(const uint32_t *canvas, int stride, const DirtyRect &r) {
+        rect = r;
+        words.clear();
+        for (int y = 0; y < rect.h; y++) {
+            const uint32_t *row = canvas + (rect.y + y) * stride + rect.x;
+            size_t literal = 0; // index of count word of open literal, 0 when none
+            for (int x = 0; x < rect.w;) {
+                int n = 1;
+                while (x + n < rect.w && row[x + n] == row[x]) {
+                    n++;
+                }
+
+                if (n >= MIN_RUN) {
+                    literal = 0;
+                    words.push_back(RUN | uint32_t(n));
+                    words.push_back(row[x]);
+                } else {
+                    if (!literal) {
+                        literal = words.size() + 1;
+                        words.push_back(0);
+                    }
+                    words[literal - 1] += n;
+                    words.insert(words.end(), row + x, row + x + n);
+                }
+                x += n;
+            }
+        }
+        words.shrink_to_fit();
+    }
+
+    void decode(uint32_t *canvas, int stride) const {
+        const uint32_t *word = words.data();
+        for (int y = 0; y < rect.h; y++) {
+            uint32_t *row = canvas + (rect.y + y) * stride + rect.x;
+            for (int x = 0; x < rect.w;) {
+                const uint32_t n = *word & ~RUN;
+                if (*word++ & RUN) {
+                    std::fill(row + x, row + x + n, *word++);
+                } else {
+                    memcpy(row + x, word, n * sizeof(uint32_t));
+                    word += n;
+                }
+                x += n;
+            }
+        }
+    }
+
+    size_t bytes() const { return sizeof(*this) + words.capacity() * sizeof(uint32_t); }
+};
+
+// Whole loop of animation at one size, every frame is kept as area changed
+// since previous one, frames[0] holds change from last frame back to first
+struct LottieBakedLoop {
+    int width = 0;
+    int height = 0;
+    // first frame in full, for canvas holding something else
+    LottieBakedFrame first;
+    std::vector<LottieBakedFrame> frames;
+
+    size_t bytes() const {
+        size_t total = sizeof(*this) + first.bytes();
+        for (const auto &f : frames) {
+            total += f.bytes();
+        }
+        return total;
+    }
+
+    // canvas holds frame `from` (-1 for anything else), brings it to frame `to`
+    void decode(int from, uint16_t to, uint32_t *canvas, DirtyRect &dirty) const {
+        dirty = DirtyRect();
+        if (from < 0 || from >= (int)frames.size()) {
+            first.decode(canvas, width);
+            dirty = first.rect;
+            from = 0;
+        }
+
+        const int total = (int)frames.size();
+        while (from != to) {
+            from = (from + 1) % total;
+            frames[from].decode(canvas, width);
+            dirty.unite(frames[from].rect);
+        }
+    }
+};
+
+// Baked loops of all animations, least recently used ones go away when
+// they take more than budget. Shared by render workers.
+class LottieBakeCache {
+public:
+    static constexpr size_t DEFAULT_BUDGET = 32 * 1024 * 1024;
+
+    std::shared_ptr<const LottieBakedLoop> find(ImGuiID key) {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto search = hash.find(key);
+        if (search == hash.end()) {
+            return nullptr;
+        }
+        // move to the front of the lru list.
+        lru.splice(lru.begin(), lru, search->second);
+        return search->second->loop;
+    }
+
+    // false when loop alone is bigger than budget
+    bool add(ImGuiID key, std::shared_ptr<const LottieBakedLoop> loop) {
+        const size_t size = loop->bytes();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (size > budget) {
+            return false;
+        }
+
+        auto search = hash.find(key);
+        if (search != hash.end()) {
+            used -= search->second->size;
+            lru.erase(search->second);
+        }
+
+        lru.push_front({key, size, std::move(loop)});
+        hash[key] = lru.begin();
+        used += size;
+        trim();
+        return true;
+    }
+
+    void configureBudget(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        budget = bytes;
+        trim();
+    }
+
+    void stats(size_t &bytes, size_t &entries, size_t &evicted) {
+        std::lock_guard<std::mutex> lock(mutex);
+        bytes = used;
+        entries = hash.size();
+        evicted = evictions;
+    }
+
+private:
+    struct Entry {
+        ImGuiID key;
+        size_t size;
+        std::shared_ptr<const LottieBakedLoop> loop;
+    };
+
+    void trim() {
+        while (used > budget) {
+            used -= lru.back().size;
+            hash.erase(lru.back().key);
+            lru.pop_back();
+            evictions++;
+        }
+    }
+
+    std::mutex mutex;
+    std::list<Entry> lru;
+    std::unordered_map<ImGuiID, std::list<Entry>::iterator> hash;
+    size_t budget = DEFAULT_BUDGET;
+    size_t used = 0;
+    size_t evictions = 0;
+};
+
 class LottieAnimationRenderer;
 namespace detail {
     LottieAnimationRenderer *g_lottieRenderer = nullptr;
@@ -77,17 +339,15 @@ struct LottieAnim {
     static constexpr int DEFAULT_SIZE = 32;
     // how many prerendered frames saved in array
     static constexpr int DEFAULT_PRERENDERED_FRAMES = 2;
+    // frame slots of animation, prerendered frames and published ones
+    // which main thread did not take yet
+    static constexpr int FRAME_RING_SIZE = DEFAULT_PRERENDERED_FRAMES + 3;
     static constexpr int LOTTIE_SURFACE_FMT = sizeof(uint32_t); // TEXFMT_A8R8G8B8;
     static constexpr int LOTTIE_SURFACE_FMT_BPP = sizeof(uint32_t);
 
     // A unique identifier for the picture
     ImGuiID pid = BAD_PICTUREID;
 
-#ifdef IMLOTTIE_DX11_IMPLEMENTATION
-    // DirectX 11 implementation
-    ID3D11Texture2D* texture = nullptr;
-    ID3D11ShaderResourceView *srv = nullptr;
-#endif // IMLOTTIE_DX11_IMPLEMENTATION
     struct {
         int width = DEFAULT_SIZE;
         int height = DEFAULT_SIZE;
@@ -108,27 +368,34 @@ struct LottieAnim {
     bool play = false;
     bool renderonce = false;
 
+    // raised from UI thread when widget was drawn, becomes renderonce on next pass
+    std::shared_ptr<std::atomic<bool>> wanted;
+
     int maxPrerenderedFrames = DEFAULT_PRERENDERED_FRAMES;
     std::string lottiePath;
 
     std::shared_ptr<imlottie::Animation> anim;
     // we need save future frames, because are can have
-    // different time for render, thread render it on loop
-    std::queue<NextFrame> prerenderedFrames;
-
-    // here saved frame, which need for display, on every render()
-    // call prerendered frame will moved here when time for next frame gone
-    ReadyFrame currentFrame;
-
-    // Grabs the current frame and stores it in the "f" parameter
-    bool grabCurrentFrame(ReadyFrame &f) {
-        if (currentFrame.pid == BAD_PICTUREID) {
-            return false;
-        }
-
-        std::swap(f, currentFrame);
-        return true;
-    }
+    // different time for render, thread render it on loop.
+    // When time for next frame gone prerendered frame is published
+    // here and main thread takes it, shared with LottieAnimDesc
+    std::shared_ptr<LottieFrameRing> frames;
+
+    // last rendered frame, next frames repaint only what changed in it
+    std::vector<uint8_t> canvasBuffer;
+    // frame index canvas holds, -1 when none
+    int canvasFrame = -1;
+
+    // looping animation renders every frame once and later loops decode
+    // them from baked loop, while cache keeps it
+    bool bake = false;
+    LottieBakeCache *bakeCache = nullptr;
+    ImGuiID bakeKey = BAD_PICTUREID;
+    // loop being recorded from rendered frames, and frame it expects next
+    std::shared_ptr<LottieBakedLoop> recording;
+    uint16_t recordNext = 0;
+    // canvas was painted from baked loop, renderer does not know what it holds
+    bool rendererStale = false;
 
     // Returns a hash code based on the properties of the Lottie animation
     static ImGuiID getPropsHash(const char *lottie, const int canvasWidth, const int canvasHeight, bool loop, int rate) {
@@ -168,8 +435,39 @@ struct LottieAnim {
         return true;
     }
 
-    bool render(uint32_t curTime) {
+    // prerendered frames array has room and there is a frame to put there
+    bool needPrerender() const {
+        if (!frames || frames->full())
+            return false;
+
+        if (frames->prerendered() > (size_t)std::max<int>(maxPrerenderedFrames, DEFAULT_PRERENDERED_FRAMES))
+            return false;
+
+        uint16_t nextFrameIndex = frame.current + (uint16_t)frames->prerendered();
+        if (loop) {
+            nextFrameIndex = (nextFrameIndex % frame.total);
+        }
+        return nextFrameIndex < frame.total;
+    }
+
+    // time in ms until render() has something to do, NO_WAKEUP while
+    // animation paused or finished
+    uint32_t wakeupDelay(uint32_t curTime) const {
         if (pid == BAD_PICTUREID || !(play || renderonce))
+            return NO_WAKEUP;
+
+        if (!loop && frame.current > frame.total)
+            return NO_WAKEUP;
+
+        if (renderonce || needPrerender())
+            return 0;
+
+        uint32_t nextFrameMs = timeline.last_ms + timeline.duration_ms;
+        return nextFrameMs > curTime ? nextFrameMs - curTime : 0;
+    }
+
+    bool render(uint32_t curTime) {
+        if (pid == BAD_PICTUREID || !frames || !(play || renderonce))
             return false;
 
         renderonce = false;
@@ -178,35 +476,25 @@ struct LottieAnim {
 
         uint32_t frameDiff = (curTime - timeline.last_ms) / timeline.duration_ms;
         if (frameDiff != 0) {
-            // move first of prerendered frames to readyFrame, main thread
-            // after render it will be move to readFrames array
-            if (prerenderedFrames.size() > 0) {
-                // move the first pre-rendered frame to the current frame
-                NextFrame nextFrame;
-                std::swap(nextFrame, prerenderedFrames.front());
-                prerenderedFrames.pop();
-                std::swap(currentFrame.data, nextFrame.data);
-                currentFrame.size = nextFrame.size;
-                currentFrame.pid = pid;
-#if DEBUG_LOTTIE_UPDATE
-                // for debugging purposes, set the lottie path, current frame and duration
-                currentFrame.lottie = lottiePath.c_str();
-                currentFrame.frame = frame.current;
-                currentFrame.duration_ms = timeline.duration_ms;
-#endif // DEBUG_LOTTIE_UPDATE
-            }
-
-            // switch to next frame index
-            frame.current++;
-            if (loop) {
-                frame.current %= frame.total;
+            // first of prerendered frames goes to main thread, it copies
+            // it to texture on next update
+            const bool published = frames->publish();
+
+            // switch to next frame index. while none is ready (ring full of
+            // frames main thread did not take yet) current frame is held,
+            // so no frame is skipped, only past the last one it goes on
+            if (published || (!loop && frame.current >= frame.total)) {
+                frame.current++;
+                if (loop) {
+                    frame.current %= frame.total;
+                }
             }
             timeline.last_ms += frameDiff * timeline.duration_ms;
         }
 
-        if (prerenderedFrames.size() <= std::max<int>(maxPrerenderedFrames, DEFAULT_PRERENDERED_FRAMES)) {
+        if (needPrerender()) {
             // calc next prerendered frame index
-            uint16_t nextFrameIndex = frame.current + (uint16_t)prerenderedFrames.size();
+            uint16_t nextFrameIndex = frame.current + (uint16_t)frames->prerendered();
 
             // if loop we need back to 0 and render again
             if (loop) {
@@ -215,129 +503,277 @@ struct LottieAnim {
 
             // not need prerender frames when all finished
             if (nextFrameIndex < frame.total) {
-                // create new frame
-                prerenderedFrames.push({});
-                NextFrame &nextFrame = prerenderedFrames.back();
+                // slot keeps its memory, only first frame written to it allocates
+                ReadyFrame &nextFrame = *frames->beginWrite();
 
                 // size for next frame memory
                 size_t bufferSize = canvas.width * canvas.height * LOTTIE_SURFACE_FMT_BPP;
 
-                // create memory block where will be placed frame
-                nextFrame.data.resize(bufferSize);
+                // first frame is painted in full into a cleared canvas
+                if (canvasBuffer.size() != bufferSize) {
+                    canvasBuffer.assign(bufferSize, 0);
+                }
 
                 // save frame size for next actions
                 nextFrame.size = ImVec2((float)canvas.width, (float)canvas.height);
 
-                imlottie::animationRenderSync(anim, nextFrameIndex, (uint32_t *)nextFrame.data.data(), canvas.width, canvas.height, canvas.width *LOTTIE_SURFACE_FMT_BPP);
+                paintCanvas(nextFrameIndex, nextFrame.dirty);
+
+                // frame keeps its own copy, the canvas is repainted in place
+                nextFrame.data.resize(bufferSize);
+                memcpy(nextFrame.data.data(), canvasBuffer.data(), bufferSize);
+#if DEBUG_LOTTIE_UPDATE
+                // for debugging purposes, set the lottie path, frame and duration
+                nextFrame.lottie = lottiePath.c_str();
+                nextFrame.frame = nextFrameIndex;
+                nextFrame.duration_ms = timeline.duration_ms;
+#endif // DEBUG_LOTTIE_UPDATE
+                frames->endWrite();
                 return true;
             }
         }
 
         return false;
-}
+    }
 
-    // Simple helper function to load an image into a DX11 texture with common settings
-#ifdef IMLOTTIE_DX11_IMPLEMENTATION
-    bool createTextureFromData(uint8_t *image_data, ::ID3D11Device* pd3dDevice) {
-        if (image_data == NULL) {
-            return false;
+    // brings canvas to frame index, dirty gets area which changed
+    void paintCanvas(uint16_t index, DirtyRect &dirty) {
+        uint32_t *pixels = (uint32_t *)canvasBuffer.data();
+        const int pitch = canvas.width * LOTTIE_SURFACE_FMT_BPP;
+
+        if (bake && bakeCache) {
+            if (auto baked = bakeCache->find(bakeKey)) {
+                baked->decode(canvasFrame, index, pixels, dirty);
+                canvasFrame = index;
+                rendererStale = true;
+                return;
+            }
         }
 
-        // Create texture
-        D3D11_TEXTURE2D_DESC desc;
-        ZeroMemory(&desc, sizeof(desc));
-        desc.Width = canvas.width;
-        desc.Height = canvas.height;
-        desc.MipLevels = 1;
-        desc.ArraySize = 1;
-        desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-        desc.SampleDesc.Count = 1;
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-        desc.Usage = D3D11_USAGE_DYNAMIC;
-
-        D3D11_SUBRESOURCE_DATA subResource;
-        subResource.pSysMem = image_data;
-        subResource.SysMemPitch = desc.Width * 4;
-        subResource.SysMemSlicePitch = 0;
-        pd3dDevice->CreateTexture2D(&desc, &subResource, &texture);
+        if (rendererStale) {
+            // baked loop was evicted, paint whole frame and renderer starts
+            // tracking canvas again from it
+            imlottie::animationRenderSync(anim, index, pixels, canvas.width, canvas.height, pitch);
+            dirty = {0, 0, canvas.width, canvas.height};
+            rendererStale = false;
+        } else {
+            imlottie::animationRenderRetained(anim, index, pixels, canvas.width, canvas.height, pitch,
+                                              dirty.x, dirty.y, dirty.w, dirty.h);
+        }
+        canvasFrame = index;
 
-        // Create texture view
-        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
-        ZeroMemory(&srvDesc, sizeof(srvDesc));
-        srvDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-        srvDesc.Texture2D.MipLevels = desc.MipLevels;
-        srvDesc.Texture2D.MostDetailedMip = 0;
-        pd3dDevice->CreateShaderResourceView(texture, &srvDesc, &srv);
-        //pTexture->Release();
-        return true;
+        if (bake && bakeCache) {
+            recordFrame(index, dirty);
+        }
     }
 
-    bool updateTextureFromData(unsigned char* image_data, ID3D11DeviceContext* ctx) {
-        if (!image_data) {
-            return false;
-        }
+    // frames rendered one after another from first make baked loop, it goes
+    // to cache when loop comes back to first frame
+    void recordFrame(uint16_t index, const DirtyRect &dirty) {
+        const uint32_t *pixels = (const uint32_t *)canvasBuffer.data();
 
-        D3D11_MAPPED_SUBRESOURCE ms;
-        HRESULT hr = ctx->Map(texture, 0, D3D11_MAP_WRITE_DISCARD, 0, &ms);
-        if (FAILED(hr)) {
-            return false;
+        if (recording && index != recordNext) {
+            // frame skipped, change since previous one is unknown
+            recording.reset();
         }
 
-        const uint8_t* src = image_data;
-        uint8_t* dst = (uint8_t*)ms.pData;
-
-        uint32_t bytes_per_row = canvas.width * 4;
-        for (int y = 0; y < canvas.height; ++y) {
-            memcpy(dst, src, bytes_per_row);
-            src += bytes_per_row;
-            dst += ms.RowPitch;
+        if (!recording) {
+            if (index != 0) {
+                return;
+            }
+            recording = std::make_shared<LottieBakedLoop>();
+            recording->width = canvas.width;
+            recording->height = canvas.height;
+            recording->frames.resize(frame.total);
+            recording->first.encode(pixels, canvas.width, {0, 0, canvas.width, canvas.height});
+            recordNext = 1 % frame.total;
+            return;
         }
 
-        ctx->Unmap(texture, 0);
-        return true;
+        recording->frames[index].encode(pixels, canvas.width, dirty);
+        recordNext = (index + 1) % frame.total;
+        if (index == 0) {
+            if (!bakeCache->add(bakeKey, std::move(recording))) {
+                // would never fit, stop recording it every loop
+                bake = false;
+            }
+            recording.reset();
+        }
     }
-#endif // IMLOTTIE_DX11_IMPLEMENTATION
 };
 
 struct LottieRenderCommand {
-    enum Type { UNKNOWN = 0, ADD_CONFIG, DISCARD_PID, SETUP_PID, SETUP_PLAY, SETUP_RENDER };
-    Type type;
+    enum Type { UNKNOWN = 0, ADD_CONFIG, DISCARD_PID, SETUP_PID, SETUP_PLAY };
+    // commands set only their own fields, rest keeps these
+    Type type = UNKNOWN;
     std::string path;
-    int w, h;
-    int loop;
-    int rate;
-    ImGuiID pid;
-    bool play;
-    bool render;
+    int w = 0, h = 0;
+    int loop = 0;
+    int rate = 0;
+    ImGuiID pid = 0;
+    bool play = true;
+    bool bake = false;
+    std::shared_ptr<std::atomic<bool>> wanted;
+    std::shared_ptr<LottieFrameRing> frames;
+};
+
+// Renders the independent animations of one pass concurrently. Thread which
+// calls run() takes part in the work too, without workers it renders serially.
+struct LottieRenderPool {
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    // owned by caller of run(), not copied
+    const std::function<void(size_t)> *job = nullptr;
+    size_t jobCount = 0;
+    std::atomic<size_t> nextJob{0};
+    size_t busy = 0;
+    uint64_t pass = 0;
+    bool stopping = false;
+
+    void start(int count) {
+        for (int i = 0; i < count; ++i) {
+            workers.emplace_back([this] () { workerLoop(); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    // calls fn(0) .. fn(count - 1) spread over workers, returns when all done
+    void run(size_t count, const std::function<void(size_t)> &fn) {
+        if (workers.empty() || count < 2) {
+            for (size_t i = 0; i < count; ++i) {
+                fn(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobCount = count;
+            nextJob.store(0);
+            busy = workers.size();
+            ++pass;
+        }
+        wake.notify_all();
+
+        drain();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [this] () { return busy == 0; });
+        job = nullptr;
+    }
+
+    void drain() {
+        for (size_t i = nextJob++; i < jobCount; i = nextJob++) {
+            (*job)(i);
+        }
+    }
+
+    void workerLoop() {
+        uint64_t seenPass = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this, &seenPass] () { return stopping || pass != seenPass; });
+            if (stopping)
+                return;
+
+            seenPass = pass;
+            lock.unlock();
+            drain();
+            lock.lock();
+            if (--busy == 0)
+                finished.notify_one();
+        }
+    }
 };
 
 // this thread resolve command to load lotti animations, and their render frames
 struct LottieRenderThread {
     std::atomic_int terminating = false;
-    bool popCommand(LottieRenderCommand &command) {
-        std::lock_guard<std::mutex> lock(commandsMutex);
-        if (commands.empty())
-            return false;
 
-        std::swap(command, commands.front());
-        commands.pop();
-        return true;
+    // threads rendering animations next to this one, 0 renders them one by one
+    int workerCount = 0;
+    // time one pass over animations may take, animations not started
+    // when it runs out wait for the next pass (and go first there), 0 disables
+    uint32_t frameBudgetMs = 0;
+
+    // takes all commands queued so far, they are resolved in one go
+    void takeCommands(std::queue<LottieRenderCommand> &batch) {
+        std::lock_guard<std::mutex> lock(commandsMutex);
+        std::swap(batch, commands);
     }
 
     void addCommand(const LottieRenderCommand &command) {
-        if (commands.size() > 100) {
-            return;
+        {
+            std::lock_guard<std::mutex> lock(commandsMutex);
+            if (commands.size() > 100) {
+                return;
+            }
+            commands.push(command);
         }
-        std::lock_guard<std::mutex> lock(commandsMutex);
-        commands.push(command);
+        wakeup.notify_one();
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(commandsMutex);
+            terminating.store(true);
+        }
+        wakeup.notify_one();
+    }
+
+    // widget asks for its animation every frame, so this stays lock free
+    // unless the thread sleeps and needs waking
+    void requestRender(std::atomic<bool> &wanted) {
+        if (wanted.exchange(true))
+            return;
+
+        if (renderRequested.exchange(true))
+            return;
+
+        // thread checks renderRequested under this mutex before sleeping
+        { std::lock_guard<std::mutex> lock(commandsMutex); }
+        wakeup.notify_one();
+    }
+
+    // main thread clock, thread counts time from last update itself so it
+    // can sleep till next frame without main thread waking it
+    void setTime(float ms) {
+        std::lock_guard<std::mutex> lock(timeMutex);
+        timeBaseMs = ms;
+        timeBaseAt = std::chrono::steady_clock::now();
+    }
+
+    uint32_t currentTime() {
+        std::lock_guard<std::mutex> lock(timeMutex);
+        auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - timeBaseAt);
+        return (uint32_t)(timeBaseMs + elapsed.count());
     }
 
     std::thread independentThread;
+    // frames of looping animations in bake mode
+    LottieBakeCache bakeCache;
+    // keyed by pid
     std::unordered_map<uint32_t, LottieAnim> animations;
 
+    LottieRenderPool renderPool;
+    // animations of the current pass, and where the next pass starts from
+    std::vector<LottieAnim *> passAnimations;
+    size_t passOffset = 0;
+
     // this queue contain commands for animations
     // load - load animation may take much time
     // discard - after reset\remove image in PM we need remove it from quese
@@ -347,32 +783,14 @@ struct LottieRenderThread {
     // setup play flag - for future, when we need change play status
     std::mutex commandsMutex;
     std::queue<LottieRenderCommand> commands;
+    // signaled on new commands and stop, thread sleeps on it between frames
+    std::condition_variable wakeup;
+    // some animation raised its wanted flag since the last pass
+    std::atomic<bool> renderRequested{false};
 
-    // this queue contain ready frames from animations, it placed in system
-    // memory that another thread can copy their to PM texture later
-    std::mutex readyFramesMutex;
-    std::queue<ReadyFrame> readyFrames;
-    float curtime = 0;
-
-    void pushReadyFrame(ReadyFrame &frame, size_t maxAnimSize) {
-        std::lock_guard<std::mutex> lock(readyFramesMutex);
-        // remove extra frames, that avoid creating infinite queue
-        if (readyFrames.size() > maxAnimSize)
-            readyFrames.pop();
-
-        readyFrames.push({});
-        std::swap(readyFrames.back(), frame);
-    }
-
-    bool popReadyFrame(ReadyFrame &frame) {
-        std::lock_guard<std::mutex> lock(readyFramesMutex);
-        if (readyFrames.empty())
-            return false;
-
-        std::swap(frame, readyFrames.front());
-        readyFrames.pop();
-        return true;
-    }
+    std::mutex timeMutex;
+    float timeBaseMs = 0;
+    std::chrono::steady_clock::time_point timeBaseAt = std::chrono::steady_clock::now();
 
     // resolve command in thread, because it can be added async from another thread
     void resolveCommand(const LottieRenderCommand &cmd) {
@@ -382,80 +800,585 @@ struct LottieRenderThread {
             LottieAnim anim;
             bool loadOk = anim.load(cmd.path.c_str(), cmd.w, cmd.h, cmd.loop, true, 2, cmd.rate, cmd.pid);
             if (loadOk) {
+                anim.wanted = cmd.wanted;
+                anim.frames = cmd.frames;
+                if (cmd.bake && anim.loop) {
+                    // baked loop belongs to file and size, same for any rate
+                    anim.bake = true;
+                    anim.bakeCache = &bakeCache;
+                    anim.bakeKey = LottieAnim::getPropsHash(cmd.path.c_str(), anim.canvas.width, anim.canvas.height, true, 0);
+                }
                 animations.insert({cmd.pid, std::move(anim)});
             }
         } break;
 
         case LottieRenderCommand::DISCARD_PID:
         {
-            auto it = std::find_if( animations.begin(), animations.end(), [pid = cmd.pid](auto &a) { return a.second.pid == pid; });
-            if (it != animations.end())
-                animations.erase(it);
+            animations.erase(cmd.pid);
         } break;
 
         case LottieRenderCommand::SETUP_PID:
         {
+            // animation moves to its new pid, map stays keyed by pid
             const uint32_t propsHash = LottieAnim::getPropsHash(cmd.path.c_str(), cmd.w, cmd.h, cmd.loop, cmd.rate);
-            auto it = animations.find(propsHash);
-            if (it != animations.end()) {
-                it->second.pid = cmd.pid;
+            auto node = animations.extract(propsHash);
+            if (!node.empty()) {
+                node.key() = cmd.pid;
+                node.mapped().pid = cmd.pid;
+                animations.insert(std::move(node));
             }
         } break;
 
         case LottieRenderCommand::SETUP_PLAY:
         {
-            auto it = std::find_if( animations.begin(), animations.end(), [pid = cmd.pid](auto &a) { return a.second.pid == pid; });
+            auto it = animations.find(cmd.pid);
             if (it != animations.end()) {
                 it->second.play = cmd.play;
             }
         } break;
 
-        case LottieRenderCommand::SETUP_RENDER:
-        {
-            auto it = std::find_if( animations.begin(), animations.end(), [pid = cmd.pid](auto &a) { return a.second.pid == pid; });
-            if (it != animations.end()) {
-                it->second.renderonce = cmd.render;
-            }
-        } break;
-
-
         default:
         break;
         }
     }
 
     void execute() {
+        renderPool.start(workerCount);
+
+        std::queue<LottieRenderCommand> batch;
         while (!terminating.load()) {
-            LottieRenderCommand cmd;
-            if (popCommand(cmd)) {
-                resolveCommand(cmd);
+            takeCommands(batch);
+            while (!batch.empty()) {
+                resolveCommand(batch.front());
+                batch.pop();
             }
 
-            if (animations.empty()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                continue;
+            // requests raised from now on need one more pass
+            renderRequested.store(false);
+            uint32_t delay = animations.empty() ? NO_WAKEUP : renderPass();
+
+            // sleep till next frame is due, or for good when nothing plays,
+            // commands, render requests and stop wake thread earlier
+            std::unique_lock<std::mutex> lock(commandsMutex);
+            auto woken = [this] () { return !commands.empty() || renderRequested.load() || terminating.load(); };
+            if (delay == NO_WAKEUP) {
+                wakeup.wait(lock, woken);
+            } else if (delay > 0) {
+                wakeup.wait_for(lock, std::chrono::milliseconds(delay), woken);
             }
+        }
 
-            // render animations and extract current animation frame to ready frames array
-            const size_t maxAnimSize = animations.size() * 2;
-            for (auto &anim : animations) {
-                // it's loop here for all animations and frame render make a time, break
-                // it when thread want stop
-                if (terminating.load())
-                    return;
+        renderPool.stop();
+    }
 
-                // prerender next frames and prepare copy data to current frame if need
-                anim.second.render((uint32_t)curtime);
+    // render animations and publish frames which time came to their rings,
+    // returns time in ms until some animation needs next pass
+    uint32_t renderPass() {
+        passAnimations.clear();
+        for (auto &anim : animations) {
+            passAnimations.push_back(&anim.second);
+        }
 
-                // if current frame ready, we need copy it to ready frames array
-                // ready frames array will be copied to dynatlas on frame update from
-                // main thread so we need use mutex for guard access when array changes
-                ReadyFrame currentFrame;
-                if (anim.second.grabCurrentFrame(currentFrame)) {
-                    pushReadyFrame(currentFrame, maxAnimSize);
+        const size_t count = passAnimations.size();
+        const size_t offset = passOffset % count;
+        // job captures only this and pass, so std::function keeps it
+        // without allocating
+        struct {
+            size_t count;
+            size_t offset;
+            uint32_t time;
+            std::chrono::steady_clock::time_point deadline;
+            std::atomic<size_t> firstSkipped;
+        } pass;
+        pass.count = count;
+        pass.offset = offset;
+        pass.time = currentTime();
+        pass.deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(frameBudgetMs);
+        pass.firstSkipped.store(count);
+
+        renderPool.run(count, [this, &pass] (size_t i) {
+            // it's loop here for all animations and frame render make a time, break
+            // it when thread want stop
+            if (terminating.load())
+                return;
+
+            // animations started so far keep rendering, rest waits for next pass
+            // instead of holding back frames which are already done
+            if (frameBudgetMs && std::chrono::steady_clock::now() > pass.deadline) {
+                size_t skipped = pass.firstSkipped.load();
+                while (i < skipped && !pass.firstSkipped.compare_exchange_weak(skipped, i)) {
                 }
+                return;
+            }
+
+            LottieAnim &anim = *passAnimations[(pass.offset + i) % pass.count];
+            if (anim.wanted && anim.wanted->exchange(false)) {
+                anim.renderonce = true;
+            }
+
+            // prerender next frames and publish current frame if its time came,
+            // published frames will be copied to atlas on frame update from
+            // main thread, ring of animation hands them over without locks
+            anim.render(pass.time);
+        });
+
+        // skipped animations go first on the next pass
+        if (pass.firstSkipped.load() < count) {
+            passOffset = offset + pass.firstSkipped.load();
+            return 0;
+        }
+
+        const uint32_t now = currentTime();
+        uint32_t delay = NO_WAKEUP;
+        for (auto anim : passAnimations) {
+            delay = std::min(delay, anim->wakeupDelay(now));
+        }
+        return delay;
+    }
+};
+
+// Texture side of the atlas, creates page textures and copies changed pixels
+// into them. Page handle returned by createPage is what ImGui gets as texture.
+struct LottieAtlasBackend {
+    virtual ~LottieAtlasBackend() = default;
+    virtual void *createPage(int width, int height) = 0;
+    // pixels - whole page in BGRA, pitch - bytes per row of it
+    virtual void updatePage(void *page, const uint8_t *pixels, int pitch, const DirtyRect &dirty) = 0;
+    virtual void destroyPage(void *page) = 0;
+};
+
+// Keeps pages in system memory only, used until real backend set and
+// for checking packing and uploads without gpu
+struct LottieAtlasNullBackend : LottieAtlasBackend {
+    uint32_t pagesCreated = 0;
+    uint32_t pagesAlive = 0;
+    uint32_t uploads = 0;
+    uint64_t uploadedPixels = 0;
+
+    void *createPage(int, int) override {
+        pagesAlive++;
+        return (void *)(uintptr_t)(++pagesCreated);
+    }
+
+    void updatePage(void *, const uint8_t *, int, const DirtyRect &dirty) override {
+        uploads++;
+        uploadedPixels += uint64_t(dirty.w) * dirty.h;
+    }
+
+    void destroyPage(void *) override {
+        pagesAlive--;
+    }
+};
+
+#ifdef IMLOTTIE_DX11_IMPLEMENTATION
+// Page is texture updated in place with UpdateSubresource, handle is its SRV
+struct LottieAtlasDX11Backend : LottieAtlasBackend {
+    ID3D11Device *device = nullptr;
+    ID3D11DeviceContext *ctx = nullptr;
+    std::unordered_map<void *, ID3D11Texture2D *> textures;
+
+    void *createPage(int width, int height) override {
+        if (!device) {
+            return nullptr;
+        }
+
+        D3D11_TEXTURE2D_DESC desc;
+        ZeroMemory(&desc, sizeof(desc));
+        desc.Width = width;
+        desc.Height = height;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+        desc.SampleDesc.Count = 1;
+        // updated in place, only changed area of page
+        desc.Usage = D3D11_USAGE_DEFAULT;
+        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+        desc.CPUAccessFlags = 0;
+
+        ID3D11Texture2D *texture = nullptr;
+        if (FAILED(device->CreateTexture2D(&desc, nullptr, &texture))) {
+            return nullptr;
+        }
+
+        D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+        ZeroMemory(&srvDesc, sizeof(srvDesc));
+        srvDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+        srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+        srvDesc.Texture2D.MipLevels = desc.MipLevels;
+        srvDesc.Texture2D.MostDetailedMip = 0;
+
+        ID3D11ShaderResourceView *srv = nullptr;
+        if (FAILED(device->CreateShaderResourceView(texture, &srvDesc, &srv))) {
+            texture->Release();
+            return nullptr;
+        }
+
+        textures[srv] = texture;
+        return srv;
+    }
+
+    void updatePage(void *page, const uint8_t *pixels, int pitch, const DirtyRect &dirty) override {
+        auto it = textures.find(page);
+        if (it == textures.end() || !ctx) {
+            return;
+        }
+
+        D3D11_BOX box;
+        box.left = dirty.x;
+        box.top = dirty.y;
+        box.front = 0;
+        box.right = dirty.x + dirty.w;
+        box.bottom = dirty.y + dirty.h;
+        box.back = 1;
+
+        const uint8_t *src = pixels + dirty.y * pitch + dirty.x * LottieAnim::LOTTIE_SURFACE_FMT_BPP;
+        ctx->UpdateSubresource(it->second, 0, &box, src, pitch, 0);
+    }
+
+    void destroyPage(void *page) override {
+        auto it = textures.find(page);
+        if (it == textures.end()) {
+            return;
+        }
+
+        ((ID3D11ShaderResourceView *)page)->Release();
+        it->second->Release();
+        textures.erase(it);
+    }
+};
+#endif // IMLOTTIE_DX11_IMPLEMENTATION
+
+// Place of animation frame in atlas
+struct LottieAtlasRegion {
+    int page = -1;
+    int x = 0, y = 0, w = 0, h = 0;
+    ImVec2 uv0, uv1;
+
+    bool valid() const { return page >= 0; }
+};
+
+// Packs frames of many animations into shared pages, so frames of all icons
+// reach gpu with one upload per page and ImGui draws them without switching
+// textures. Pages are filled with skyline bottom-left packing, freed places
+// are reused by frames which fit them, page is reset when it gets empty.
+// Frames bigger than page get own page of their size.
+// Used from main thread only.
+class LottieAtlas {
+public:
+    static constexpr int DEFAULT_PAGE_SIZE = 512;
+    // empty pixels around frame, linear filter must not pick neighbour frame
+    static constexpr int PADDING = 1;
+
+    explicit LottieAtlas(int pageSize = DEFAULT_PAGE_SIZE) : pageSize(pageSize), backend(new LottieAtlasNullBackend()) {}
+
+    ~LottieAtlas() {
+        for (auto &page : pages) {
+            if (page.used) {
+                backend->destroyPage(page.texture);
+            }
+        }
+    }
+
+    // pages made by previous backend are created again with new one and
+    // uploaded in full on next flush
+    void setBackend(std::unique_ptr<LottieAtlasBackend> newBackend) {
+        for (auto &page : pages) {
+            if (!page.used) {
+                continue;
+            }
+
+            backend->destroyPage(page.texture);
+            page.texture = newBackend->createPage(page.width, page.height);
+            page.dirty = {0, 0, page.width, page.height};
+        }
+        backend = std::move(newBackend);
+    }
+
+    LottieAtlasBackend *getBackend() const { return backend.get(); }
+
+    bool allocate(int w, int h, LottieAtlasRegion &region) {
+        if (w <= 0 || h <= 0) {
+            return false;
+        }
+
+        const int pw = w + PADDING * 2;
+        const int ph = h + PADDING * 2;
+        if (pw > pageSize || ph > pageSize) {
+            // does not fit any shared page
+            int index = createPage(w, h, true);
+            place(index, {0, 0, w, h}, 0, region);
+            return true;
+        }
+
+        for (int i = 0; i < (int)pages.size(); i++) {
+            Page &page = pages[i];
+            if (!page.used || page.dedicated) {
+                continue;
+            }
+
+            DirtyRect rect;
+            if (takeFreeRect(page, pw, ph, rect) || skylineInsert(page, pw, ph, rect)) {
+                place(i, rect, PADDING, region);
+                return true;
+            }
+        }
+
+        int index = createPage(pageSize, pageSize, false);
+        DirtyRect rect;
+        if (!skylineInsert(pages[index], pw, ph, rect)) {
+            return false;
+        }
+        place(index, rect, PADDING, region);
+        return true;
+    }
+
+    void release(LottieAtlasRegion &region) {
+        if (!region.valid() || region.page >= (int)pages.size()) {
+            return;
+        }
+
+        Page &page = pages[region.page];
+        page.regions--;
+        if (page.regions > 0) {
+            const int pad = page.dedicated ? 0 : PADDING;
+            page.freeRects.push_back({region.x - pad, region.y - pad, region.w + pad * 2, region.h + pad * 2});
+        } else if (page.dedicated || countSharedPages() > 1) {
+            backend->destroyPage(page.texture);
+            page = Page();
+        } else {
+            // keep last shared page, next frames go there anyway
+            page.skyline.assign(1, {0, 0, page.width});
+            page.freeRects.clear();
+        }
+        region = LottieAtlasRegion();
+    }
+
+    // copy changed area of frame to its place in page, pitch - bytes per row of frame
+    void write(const LottieAtlasRegion &region, const uint8_t *frame, int pitch, const DirtyRect &dirty) {
+        if (!region.valid() || !frame) {
+            return;
+        }
+
+        DirtyRect area = dirty;
+        clip(area, region.w, region.h);
+        if (area.empty()) {
+            return;
+        }
+
+        Page &page = pages[region.page];
+        const int bpp = LottieAnim::LOTTIE_SURFACE_FMT_BPP;
+        const int pagePitch = page.width * bpp;
+        for (int row = 0; row < area.h; row++) {
+            const uint8_t *src = frame + (area.y + row) * pitch + area.x * bpp;
+            uint8_t *dst = page.pixels.data() + (region.y + area.y + row) * pagePitch + (region.x + area.x) * bpp;
+            memcpy(dst, src, area.w * bpp);
+        }
+
+        page.dirty.unite({region.x + area.x, region.y + area.y, area.w, area.h});
+    }
+
+    // one upload for every page changed since last flush
+    void flush() {
+        for (auto &page : pages) {
+            if (page.used && !page.dirty.empty()) {
+                backend->updatePage(page.texture, page.pixels.data(), page.width * LottieAnim::LOTTIE_SURFACE_FMT_BPP, page.dirty);
+                page.dirty = DirtyRect();
+            }
+        }
+    }
+
+    void *texture(const LottieAtlasRegion &region) const {
+        return (region.valid() && region.page < (int)pages.size()) ? pages[region.page].texture : nullptr;
+    }
+
+    size_t pageCount() const { return pages.size() - std::count_if(pages.begin(), pages.end(), [] (auto &p) { return !p.used; }); }
+
+    // system memory copy of page, what backend got on last flush
+    const uint8_t *pagePixels(int page) const { return pages[page].pixels.data(); }
+
+private:
+    struct SkylineNode {
+        int x, y, width;
+    };
+
+    struct Page {
+        bool used = false;
+        bool dedicated = false;
+        void *texture = nullptr;
+        int width = 0, height = 0;
+        int regions = 0;
+        std::vector<uint8_t> pixels;
+        std::vector<SkylineNode> skyline;
+        std::vector<DirtyRect> freeRects;
+        DirtyRect dirty;
+    };
+
+    int pageSize;
+    std::unique_ptr<LottieAtlasBackend> backend;
+    std::vector<Page> pages;
+
+    static void clip(DirtyRect &r, int w, int h) {
+        int right = std::min(r.x + r.w, w);
+        int bottom = std::min(r.y + r.h, h);
+        r.x = std::max(r.x, 0);
+        r.y = std::max(r.y, 0);
+        r.w = right - r.x;
+        r.h = bottom - r.y;
+    }
+
+    size_t countSharedPages() const {
+        return std::count_if(pages.begin(), pages.end(), [] (auto &p) { return p.used && !p.dedicated; });
+    }
+
+    int createPage(int w, int h, bool dedicated) {
+        auto it = std::find_if(pages.begin(), pages.end(), [] (auto &p) { return !p.used; });
+        if (it == pages.end()) {
+            it = pages.insert(pages.end(), Page());
+        }
+
+        Page &page = *it;
+        page.used = true;
+        page.dedicated = dedicated;
+        page.width = w;
+        page.height = h;
+        page.pixels.assign(size_t(w) * h * LottieAnim::LOTTIE_SURFACE_FMT_BPP, 0);
+        page.skyline.assign(1, {0, 0, w});
+        page.texture = backend->createPage(w, h);
+        return int(it - pages.begin());
+    }
+
+    // rect - place with padding, frame is inside it
+    void place(int index, const DirtyRect &rect, int pad, LottieAtlasRegion &region) {
+        Page &page = pages[index];
+        page.regions++;
+
+        // place may keep pixels of released frame, clear it with padding
+        const int pagePitch = page.width * LottieAnim::LOTTIE_SURFACE_FMT_BPP;
+        for (int row = 0; row < rect.h; row++) {
+            memset(page.pixels.data() + (rect.y + row) * pagePitch + rect.x * LottieAnim::LOTTIE_SURFACE_FMT_BPP, 0, rect.w * LottieAnim::LOTTIE_SURFACE_FMT_BPP);
+        }
+        page.dirty.unite(rect);
+
+        region.page = index;
+        region.x = rect.x + pad;
+        region.y = rect.y + pad;
+        region.w = rect.w - pad * 2;
+        region.h = rect.h - pad * 2;
+        region.uv0 = ImVec2(float(region.x) / page.width, float(region.y) / page.height);
+        region.uv1 = ImVec2(float(region.x + region.w) / page.width, float(region.y + region.h) / page.height);
+    }
+
+    // smallest freed place where frame fits, animations often have same sizes.
+    // frame takes its top left corner, rest is cut in two along the shorter
+    // leftover side and both pieces stay free
+    static bool takeFreeRect(Page &page, int w, int h, DirtyRect &rect) {
+        auto best = page.freeRects.end();
+        for (auto it = page.freeRects.begin(); it != page.freeRects.end(); ++it) {
+            if (it->w >= w && it->h >= h && (best == page.freeRects.end() || it->w * it->h < best->w * best->h)) {
+                best = it;
+            }
+        }
+
+        if (best == page.freeRects.end()) {
+            return false;
+        }
+
+        const DirtyRect place = *best;
+        page.freeRects.erase(best);
+        rect = {place.x, place.y, w, h};
+
+        const int restW = place.w - w;
+        const int restH = place.h - h;
+        DirtyRect right, below;
+        if (restW < restH) {
+            right = {place.x + w, place.y, restW, h};
+            below = {place.x, place.y + h, place.w, restH};
+        } else {
+            right = {place.x + w, place.y, restW, place.h};
+            below = {place.x, place.y + h, w, restH};
+        }
+        if (!right.empty()) {
+            page.freeRects.push_back(right);
+        }
+        if (!below.empty()) {
+            page.freeRects.push_back(below);
+        }
+        return true;
+    }
+
+    // y where rect of width w may stand on skyline starting from node index, -1 if not fits
+    static int skylineFit(const Page &page, size_t index, int w, int h) {
+        int x = page.skyline[index].x;
+        if (x + w > page.width) {
+            return -1;
+        }
+
+        int y = page.skyline[index].y;
+        int widthLeft = w;
+        for (size_t i = index; widthLeft > 0; i++) {
+            if (i == page.skyline.size()) {
+                return -1;
+            }
+            y = std::max(y, page.skyline[i].y);
+            if (y + h > page.height) {
+                return -1;
+            }
+            widthLeft -= page.skyline[i].width;
+        }
+        return y;
+    }
+
+    static bool skylineInsert(Page &page, int w, int h, DirtyRect &rect) {
+        int bestBottom = INT_MAX;
+        int bestWidth = INT_MAX;
+        size_t bestIndex = page.skyline.size();
+        for (size_t i = 0; i < page.skyline.size(); i++) {
+            int y = skylineFit(page, i, w, h);
+            if (y < 0) {
+                continue;
+            }
+            // lowest place first, narrowest node on tie
+            if (y + h < bestBottom || (y + h == bestBottom && page.skyline[i].width < bestWidth)) {
+                bestBottom = y + h;
+                bestWidth = page.skyline[i].width;
+                bestIndex = i;
+                rect = {page.skyline[i].x, y, w, h};
+            }
+        }
+
+        if (bestIndex == page.skyline.size()) {
+            return false;
+        }
+
+        // new node on top of rect, nodes under it shrink or go away
+        auto &nodes = page.skyline;
+        nodes.insert(nodes.begin() + bestIndex, {rect.x, rect.y + h, w});
+        for (size_t i = bestIndex + 1; i < nodes.size();) {
+            const int prevRight = nodes[i - 1].x + nodes[i - 1].width;
+            if (nodes[i].x >= prevRight) {
+                break;
+            }
+
+            const int shrink = prevRight - nodes[i].x;
+            if (nodes[i].width <= shrink) {
+                nodes.erase(nodes.begin() + i);
+                continue;
             }
+            nodes[i].x += shrink;
+            nodes[i].width -= shrink;
+            break;
         }
+
+        // neighbours at same height are one node
+        for (size_t i = 0; i + 1 < nodes.size();) {
+            if (nodes[i].y == nodes[i + 1].y) {
+                nodes[i].width += nodes[i + 1].width;
+                nodes.erase(nodes.begin() + i + 1);
+            } else {
+                i++;
+            }
+        }
+        return true;
     }
 };
 
@@ -463,8 +1386,15 @@ struct LottieRenderThread {
 // for fast check we pid assigned for any animation
 struct LottieAnimDesc {
     ImVec2 size;
-    void *srv = nullptr;
+    // place of current frame in atlas, invalid until first frame arrives
+    LottieAtlasRegion region;
     ImGuiID pid = BAD_PICTUREID;
+    // shared with LottieAnim, widget raises it when drawn
+    std::shared_ptr<std::atomic<bool>> wanted;
+    // shared with LottieAnim, frames published by render thread
+    std::shared_ptr<LottieFrameRing> frames;
+    // last play flag sent to render thread
+    bool play = true;
 };
 
 struct LottieAnimationRenderer {
@@ -473,7 +1403,16 @@ struct LottieAnimationRenderer {
     std::mutex animationsPresentMutex;
     std::unordered_map<ImGuiID, LottieAnimDesc> animationsPresent;
 
-    ImGuiID match(const char *path, int w, int h, bool loop, int rate) {
+    // frames of all animations, touched from main thread only
+    LottieAtlas atlas;
+#ifdef IMLOTTIE_DX11_IMPLEMENTATION
+    // owned by atlas, set on first upload when device is known
+    LottieAtlasDX11Backend *dx11Backend = nullptr;
+#endif // IMLOTTIE_DX11_IMPLEMENTATION
+
+    // bake - render loop once and play it from bake cache after, first
+    //        match() of animation decides it
+    ImGuiID match(const char *path, int w, int h, bool loop, int rate, bool bake = false) {
         if (!path || 0 == *path) {
             return false;
         }
@@ -488,6 +1427,8 @@ struct LottieAnimationRenderer {
             LottieAnimDesc animDesc;
             animDesc.pid = propsHash;
             animDesc.size = prefferedSize;
+            animDesc.wanted = std::make_shared<std::atomic<bool>>(false);
+            animDesc.frames = std::make_shared<LottieFrameRing>(LottieAnim::FRAME_RING_SIZE);
             animationsPresent.insert({propsHash, animDesc});
 
             LottieRenderCommand command;
@@ -497,7 +1438,10 @@ struct LottieAnimationRenderer {
             command.h = (int)prefferedSize.y;
             command.loop = loop;
             command.rate = rate;
+            command.bake = bake;
             command.pid = propsHash;
+            command.wanted = animDesc.wanted;
+            command.frames = animDesc.frames;
             renderThread.addCommand(command);
             return propsHash;
         }
@@ -505,22 +1449,49 @@ struct LottieAnimationRenderer {
         return propsHash;
     }
 
+    // called for every drawn widget on every frame, repeated requests
+    // before the thread gets to the animation fold into one
     bool render(ImGuiID pid) {
-        LottieRenderCommand command;
-        command.type = LottieRenderCommand::SETUP_RENDER;
-        command.pid = pid;
-        command.render = true;
-        renderThread.addCommand(command);
+        std::lock_guard<std::mutex> lock(animationsPresentMutex);
+        auto it = animationsPresent.find(pid);
+        if (it == animationsPresent.end()) {
+            return false;
+        }
+
+        // paused animation showing its frame has nothing to render, waking
+        // thread for it would only move it on behind the widget
+        const LottieAnimDesc &desc = it->second;
+        if (!desc.play && (desc.region.valid() || desc.frames->readable())) {
+            return true;
+        }
+
+        renderThread.requestRender(*desc.wanted);
         return true;
     }
 
-    void *image(ImGuiID pid) {
-        //std::lock_guard<std::mutex> lock(animationsPresentMutex);
-        auto it = std::find_if(animationsPresent.begin(), animationsPresent.end(), [pid] (auto &a) { return a.second.pid == pid; });
-        return (it == animationsPresent.end()) ? nullptr : it->second.srv;
+    // atlas page texture with current frame of animation, uv0/uv1 get its
+    // place in page
+    void *image(ImGuiID pid, ImVec2 &uv0, ImVec2 &uv1) {
+        std::lock_guard<std::mutex> lock(animationsPresentMutex);
+        auto it = animationsPresent.find(pid);
+        if (it == animationsPresent.end()) {
+            return nullptr;
+        }
+
+        uv0 = it->second.region.uv0;
+        uv1 = it->second.region.uv1;
+        return atlas.texture(it->second.region);
     }
 
     void play(ImGuiID pid, bool play) {
+        {
+            std::lock_guard<std::mutex> lock(animationsPresentMutex);
+            auto it = animationsPresent.find(pid);
+            if (it != animationsPresent.end()) {
+                it->second.play = play;
+            }
+        }
+
         LottieRenderCommand command;
         command.type = LottieRenderCommand::SETUP_PLAY;
         command.pid = pid;
@@ -535,46 +1506,83 @@ struct LottieAnimationRenderer {
         renderThread.addCommand(command);
 
         std::lock_guard<std::mutex> lock(animationsPresentMutex);
-        auto it = std::find_if(animationsPresent.begin(), animationsPresent.end(), [pid] (auto &a) { return a.second.pid == pid; });
+        auto it = animationsPresent.find(pid);
         if (it != animationsPresent.end()) {
+            atlas.release(it->second.region);
             animationsPresent.erase(it);
         }
     }
 
+    // move frames from system memory to atlas pages, every page changed by
+    // them is uploaded once
+    void uploadReadyFramesToSysTex() {
+        {
+            std::lock_guard<std::mutex> lock(animationsPresentMutex);
+            for (auto &it : animationsPresent) {
+                LottieAnimDesc &desc = it.second;
+                const size_t count = desc.frames->readable();
+                if (count == 0) {
+                    continue;
+                }
+
+                // every frame holds whole canvas, so newest one with area
+                // changed by all of them is enough
+                const ReadyFrame &readyFrame = desc.frames->at(count - 1);
+                DirtyRect dirty;
+                for (size_t i = 0; i < count; i++) {
+                    dirty.unite(desc.frames->at(i).dirty);
+                }
+
+                const int w = (int)readyFrame.size.x;
+                const int h = (int)readyFrame.size.y;
+                if (!desc.region.valid() && atlas.allocate(w, h, desc.region)) {
+                    // new place in atlas knows nothing about previous frames
+                    dirty = {0, 0, w, h};
+                }
+                atlas.write(desc.region, readyFrame.data.data(), w * LottieAnim::LOTTIE_SURFACE_FMT_BPP, dirty);
+                desc.frames->release(count);
+            }
+        }
+
+        atlas.flush();
+        renderThread.setTime((float)ImGui::GetTime() * 1000.f);
+    }
+
 #ifdef IMLOTTIE_DX11_IMPLEMENTATION
     void uploadReadyFramesToSysTex(ID3D11Device *pd3dDevice, ID3D11DeviceContext* ctx) {
-        // prepared frames stored in readyFrames array now (in system memory)
-        // but need move those to gpu memory with textures
-        ReadyFrame readyFrame;
-        while (renderThread.popReadyFrame(readyFrame)) {
-            const auto &it = renderThread.animations.find(readyFrame.pid);
-
-            if (!it->second.texture) {
-                it->second.createTextureFromData(readyFrame.data.data(), pd3dDevice);
-                auto rit = std::find_if(animationsPresent.begin(), animationsPresent.end(), [pid = it->second.pid] (auto &a) { return a.second.pid == pid; });
-                if (rit != animationsPresent.end())
-                    rit->second.srv = it->second.srv;
-                break;
-            } else {
-                it->second.updateTextureFromData(readyFrame.data.data(), ctx);
-            }
+        if (!dx11Backend) {
+            dx11Backend = new LottieAtlasDX11Backend();
+            dx11Backend->device = pd3dDevice;
+            atlas.setBackend(std::unique_ptr<LottieAtlasBackend>(dx11Backend));
         }
+        dx11Backend->device = pd3dDevice;
+        dx11Backend->ctx = ctx;
 
-        renderThread.curtime = (float)ImGui::GetTime() * 1000.f;
+        uploadReadyFramesToSysTex();
     }
 #endif // IMLOTTIE_DX11_IMPLEMENTATION
 
-    LottieAnimationRenderer() {
-        std::thread independedThread([this] () { renderThread.execute(); });
-        independedThread.detach();
+    LottieAnimationRenderer(int renderWorkers, uint32_t frameBudgetMs, size_t bakeBudgetBytes) {
+        if (renderWorkers < 0) {
+            // rasterizer has its own threads, leave it room
+            renderWorkers = std::min<int>(std::thread::hardware_concurrency() / 2, 4);
+        }
+        renderThread.workerCount = renderWorkers;
+        renderThread.frameBudgetMs = frameBudgetMs;
+        renderThread.bakeCache.configureBudget(bakeBudgetBytes);
+        renderThread.independentThread = std::thread([this] () { renderThread.execute(); });
     }
 
     ~LottieAnimationRenderer() {
-        renderThread.terminating.store(true);
+        renderThread.stop();
+        if (renderThread.independentThread.joinable())
+            renderThread.independentThread.join();
     }
 };
 
-void LottieAnimation(const char *path, const ImVec2 &size, bool loop, int rate) {
+// bake - for small looping animations (spinners, emoji), frames of loop are
+//        rendered once and kept compressed, later loops only decode them
+void LottieAnimation(const char *path, const ImVec2 &size, bool loop, int rate, bool bake = false) {
     ImVec2 pos, centre;
     ImGuiWindow *window = ImGui::GetCurrentWindow();
     if (window->SkipItems)
@@ -595,23 +1603,32 @@ void LottieAnimation(const char *path, const ImVec2 &size, bool loop, int rate)
 
     assert(detail::g_lottieRenderer);
     if (detail::g_lottieRenderer) {
-        ImGuiID rid = detail::g_lottieRenderer->match(path, size.x, size.y, loop, rate);
+        ImGuiID rid = detail::g_lottieRenderer->match(path, size.x, size.y, loop, rate, bake);
         detail::g_lottieRenderer->render(rid); // not really render, just send command to stack we need this texture
-        void *texture = detail::g_lottieRenderer->image(rid); // get texture from renderer or null if not present
-        window->DrawList->AddImage((void *)texture, bb.Min, bb.Max, ImVec2(0, 0), ImVec2(1, 1), ImGui::GetColorU32(ImVec4(1, 1, 1, 1)));
+        ImVec2 uv0(0, 0), uv1(1, 1);
+        void *texture = detail::g_lottieRenderer->image(rid, uv0, uv1); // get atlas page from renderer or null if not present
+        window->DrawList->AddImage((void *)texture, bb.Min, bb.Max, uv0, uv1, ImGui::GetColorU32(ImVec4(1, 1, 1, 1)));
     } else {
         window->DrawList->AddRectFilled(bb.Min, bb.Max, 0xffffffff);
     }
 }
 
 
-void init() {
-    detail::g_lottieRenderer = new LottieAnimationRenderer();
+// renderWorkers - threads rendering animations concurrently next to lottie thread,
+//                 negative picks count from cpu cores, 0 renders one by one
+// frameBudgetMs - time one pass over all animations may take, animations which
+//                 did not start when it runs out are rendered on next pass, 0 disables
+// bakeBudgetBytes - memory for baked loops of animations in bake mode, least
+//                   recently played ones are dropped and rendered again
+void init(int renderWorkers = -1, uint32_t frameBudgetMs = 16, size_t bakeBudgetBytes = LottieBakeCache::DEFAULT_BUDGET) {
+    detail::g_lottieRenderer = new LottieAnimationRenderer(renderWorkers, frameBudgetMs, bakeBudgetBytes);
 }
 
 void destroy() {
     delete detail::g_lottieRenderer;
     detail::g_lottieRenderer = nullptr;
+    // render thread is gone, raster workers must be joined before dll unload
+    imlottie::shutdownRasterThreads();
 }
 
 
@@ -653,6 +1670,25 @@ void demoAnimations(const std::string &demo_folder) {
     ImLottie::LottieAnimation(_("email.json").c_str(), ImVec2(64, 64), true, 0); ImGui::SameLine();
     ImLottie::LottieAnimation(_("conused.json").c_str(), ImVec2(64, 64), true, 0);
 
+#if DEBUG_LOTTIE_UPDATE
+    size_t hits = 0, misses = 0, entries = 0;
+    imlottie::modelCacheStats(hits, misses, entries);
+    ImGui::Text("model cache: %zu hits, %zu misses, %zu models", hits, misses, entries);
+    size_t bakedBytes = 0, baked = 0, evicted = 0;
+    detail::g_lottieRenderer->renderThread.bakeCache.stats(bakedBytes, baked, evicted);
+    ImGui::Text("bake cache: %zu loops, %zu KB, %zu evicted", baked, bakedBytes / 1024, evicted);
+    size_t imageBytes = 0, images = 0, decoded = 0;
+    imlottie::imageCacheStats(imageBytes, images, decoded);
+    ImGui::Text("image cache: %zu images, %zu KB, %zu decoded", images, imageBytes / 1024, decoded);
+    size_t gradientHits = 0, gradientMisses = 0, gradientBuilds = 0;
+    imlottie::gradientCacheStats(gradientHits, gradientMisses, gradientBuilds);
+    ImGui::Text("gradient cache: %zu hits, %zu misses, %zu tables built", gradientHits, gradientMisses, gradientBuilds);
+    const std::string trace = imlottie::traceSummary();
+    if (!trace.empty()) {
+        ImGui::TextUnformatted(trace.c_str());
+    }
+#endif // DEBUG_LOTTIE_UPDATE
+
     ImGui::End();
 }
 #endif // IMLOTTIE_DEMO
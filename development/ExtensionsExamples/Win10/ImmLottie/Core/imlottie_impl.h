@@ -18,6 +18,7 @@
 
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <assert.h>
 #include <vector>
 #include <unordered_map>
@@ -32,6 +33,8 @@
 #include <array>
 #include <bitset>
 #include <deque>
+#include <new>
+#include <type_traits>
 
 #ifdef __cplusplus
 extern "C" {
@@ -124,6 +127,9 @@ struct RjValue
 struct RjInsituStringStream
 {
     RjInsituStringStream(char* str);
+    ~RjInsituStringStream();
+    RjInsituStringStream(const RjInsituStringStream &) = delete;
+    RjInsituStringStream &operator=(const RjInsituStringStream &) = delete;
     void* ss_ = nullptr;
 };
 
@@ -148,6 +154,9 @@ struct LookaheadParserHandlerBase
 struct RjReader
 {
     RjReader();
+    ~RjReader();
+    RjReader(const RjReader &) = delete;
+    RjReader &operator=(const RjReader &) = delete;
 
     void IterativeParseInit();
     bool HasParseError() const;
@@ -226,6 +235,27 @@ private:
     float _y{0};
 };
 
+struct Rect {
+    Rect() = default;
+    Rect(size_t x, size_t y, size_t w, size_t h):_x(x), _y(y), _w(w), _h(h){}
+    size_t x() const {return _x;}
+    size_t y() const {return _y;}
+    size_t w() const {return _w;}
+    size_t h() const {return _h;}
+private:
+    size_t _x{0};
+    size_t _y{0};
+    size_t _w{0};
+    size_t _h{0};
+};
+
+// Milliseconds spent in each stage of one render call.
+struct RenderTimings {
+    double update{0};    // layer tree update for the frame
+    double rasterize{0}; // paths to rle, only scheduling when raster threads run
+    double blend{0};     // rle spans to surface, includes waiting for raster threads
+};
+
 enum LOTMaskType: unsigned char
 {
     MaskAdd = 0,
@@ -1528,7 +1558,6 @@ public:
         void  addRect(const VRect &rect);
         void  clone(const VRle::VRleData &);
         std::vector<VRle::Span> mSpans;
-        VPoint                  mOffset;
         mutable VRect           mBbox;
         mutable bool            mBboxDirty = true;
     };
@@ -2089,6 +2118,7 @@ public:
     void rasterize(VPath path, CapStyle cap, JoinStyle join, float width,
                    float miterLimit, const VRect &clip = VRect());
     VRle rle();
+    void translate(const VPoint &offset);
 private:
     struct VRasterizerImpl;
     void init();
@@ -2124,9 +2154,16 @@ public:
     void    setNeedClear(bool needClear) { if (mImpl) mImpl->mNeedClear = needClear; }
     void    fill(uint pixel);
     void    updateLuma();
+    // copy shrunk 2^level times with a 2x2 box filter, built on first use
+    // and kept with the bitmap, so pixels must not change afterwards.
+    // level 0 and formats other than premultiplied argb give the bitmap.
+    VBitmap mipLevel(uint level) const;
+    // memory taken by the mip levels built so far
+    size_t  mipBytes() const;
 private:
     struct Impl {
         std::unique_ptr<uchar[]> mOwnData{nullptr};
+        size_t          mCapacity{0};
         uchar *         mRoData{nullptr};
         uint            mWidth{0};
         uint            mHeight{0};
@@ -2134,6 +2171,8 @@ private:
         uchar           mDepth{0};
         bool            mNeedClear{true};
         VBitmap::Format mFormat{VBitmap::Format::Invalid};
+        std::mutex           mMipMutex;
+        std::vector<VBitmap> mMips; // mMips[i] is level i + 1
 
         explicit Impl(size_t width, size_t height, VBitmap::Format format)
         {
@@ -2217,6 +2256,7 @@ public:
 };
 
 struct Operator;
+struct VSpanData;
 typedef void (*CompositionFunctionSolid)(uint32_t *dest, int length, uint32_t color, uint32_t const_alpha);
 typedef void (*CompositionFunction)(uint32_t *dest, const uint32_t *src, int length, uint32_t const_alpha);
 typedef void (*SourceFetchProc)(uint32_t *buffer, const Operator *o, const VSpanData *data, int y, int x, int length);
@@ -2326,6 +2366,7 @@ struct VColorTable
 
 struct VSpanData {
     enum class Type { None, Solid, LinearGradient, RadialGradient, Texture };
+    enum class TextureFilter { Nearest, Bilinear, Box };
 
     void  updateSpanFunc();
     void  init(VRasterBuffer *image);
@@ -2336,13 +2377,29 @@ struct VSpanData {
 
     VRect clipRect() const
     {
-        return VRect(0, 0, mDrawableSize.width(), mDrawableSize.height());
+        return VRect(mClipOrigin, mDrawableSize);
     }
 
     void setDrawRegion(const VRect &region)
     {
         mOffset = VPoint(region.left(), region.top());
         mDrawableSize = VSize(region.width(), region.height());
+        mClipOrigin = VPoint();
+    }
+
+    // the raster buffer only holds the part of the drawing space that
+    // starts at origin (offscreen buffers sized to a layer's bounds).
+    void setBufferOrigin(const VPoint &origin)
+    {
+        mOffset = VPoint(-origin.x(), -origin.y());
+        mClipOrigin = origin;
+    }
+
+    // restricts drawing to a part of the current drawable area.
+    void setClipRect(const VRect &rect)
+    {
+        mClipOrigin = VPoint(rect.x(), rect.y());
+        mDrawableSize = VSize(rect.width(), rect.height());
     }
 
     uint *buffer(int x, int y) const
@@ -2350,6 +2407,7 @@ struct VSpanData {
         return (uint *)(mRasterBuffer->scanLine(y + mOffset.y())) + x + mOffset.x();
     }
     void initTexture(const VBitmap *image, int alpha, VBitmapData::Type type, const VRect &sourceRect);
+    void setupTextureFilter(const VBitmap *image);
 
     BlendMode                            mBlendMode{BlendMode::SrcOver};
     VRasterBuffer *                      mRasterBuffer;
@@ -2359,6 +2417,7 @@ struct VSpanData {
     std::shared_ptr<const VColorTable>   mColorTable{nullptr};
     VPoint                               mOffset; // offset to the subsurface
     VSize                                mDrawableSize;// suburface size
+    VPoint                               mClipOrigin;  // top left of the drawable area
     union {
         uint32_t      mSolid;
         VGradientData mGradient;
@@ -2367,10 +2426,13 @@ struct VSpanData {
     float m11, m12, m13, m21, m22, m23, m33, dx, dy;  // inverse xform matrix
     bool fast_matrix{true};
     VMatrix::MatrixType   transformType{VMatrix::MatrixType::None};
+    TextureFilter         mTextureFilter{TextureFilter::Nearest};
 };
 
 void        vInitDrawhelperFunctions();
 extern void vInitBlendFunctions();
+// RGBA bytes (as decoded) to premultiplied ARGB32 in place
+void        vPremultiplyRGBA(uint32_t *pixels, size_t count);
 
 #define BYTE_MUL(c, a)                                  \
     ((((((c) >> 8) & 0x00ff00ff) * (a)) & 0xff00ff00) + \
@@ -2430,8 +2492,11 @@ public:
     VPainter() = default;
     explicit VPainter(VBitmap *buffer);
     bool  begin(VBitmap *buffer);
+    bool  begin(VBitmap *buffer, const VPoint &origin); // buffer covers the area at origin.
     void  end();
     void  setDrawRegion(const VRect &region); // sub surface rendering area.
+    void  setClipRect(const VRect &rect); // clip inside the draw region.
+    void  clear(); // zero the clip rect.
     void  setBrush(const VBrush &brush);
     void  setBlendMode(BlendMode mode);
     void  drawRle(const VPoint &pos, const VRle &rle);
@@ -2508,6 +2573,16 @@ public:
     VDrawable::Type          mType{Type::Fill};
 
     const char              *mName{nullptr};
+
+private:
+    bool translateRle(const VRect &clip);
+
+    // what the current rle was rasterized from
+    std::vector<VPath::Element> mRleElements;
+    std::vector<VPoint>         mRlePoints; // 26.6 fixed point
+    VRect                       mRleClip;
+    FillRule                    mRleFillRule{FillRule::Winding};
+    bool                        mRleReusable{false};
 };
 
 class VImageLoader
@@ -2528,6 +2603,8 @@ private:
 class VInterpolator {
 public:
     static constexpr int kSplineTableSize = 11;
+    // intervals of the value lookup table, see buildLut()
+    static constexpr int kLutSize = 256;
     VInterpolator() { /* caller must call Init later */ }
 
     VInterpolator(float aX1, float aY1, float aX2, float aY2) { init(aX1, aY1, aX2, aY2); }
@@ -2535,9 +2612,18 @@ public:
 
     void init(float aX1, float aY1, float aX2, float aY2);
     float value(float aX) const;
+    // solves the curve, value() gives the same when there is no table
+    float exactValue(float aX) const;
+    // Samples the curve so value() becomes a table lookup. The table is
+    // dropped when linear interpolation strays more than kLutTolerance
+    // from the solver anywhere, steep curves keep solving.
+    bool buildLut();
+    bool hasLut() const { return mHasLut; }
     void GetSplineDerivativeValues(float aX, float& aDX, float& aDY) const;
 
 private:
+    static constexpr float kLutTolerance = 0.0002f;
+
     void CalcSampleValues();
 
     /**
@@ -2565,32 +2651,97 @@ private:
     float mX2;
     float mY2;
     float              mSampleValues[kSplineTableSize];
+    bool               mHasLut{false};
+    float              mLut[kLutSize + 1];
 };
 
+// Bump-pointer arena. Objects are carved out of a chain of heap blocks and
+// released all at once when the arena dies. Non trivially destructible
+// objects get a footer recorded next to them, so their destructors run in
+// reverse construction order on teardown.
 class VArenaAlloc {
 public:
-    VArenaAlloc(char*, size_t, size_t) {}
+    VArenaAlloc(char* block, size_t blockSize, size_t firstHeapAllocation);
 
     explicit VArenaAlloc(size_t firstHeapAllocation)
         : VArenaAlloc(nullptr, 0, firstHeapAllocation)
     {}
 
-    ~VArenaAlloc() {}
+    ~VArenaAlloc();
+
+    VArenaAlloc(const VArenaAlloc &) = delete;
+    VArenaAlloc &operator=(const VArenaAlloc &) = delete;
 
     template <typename T, typename... Args>
     T* make(Args&&... args) {
-        return new T(std::forward<Args>(args)...);
+        char *objStart = allocObject(sizeof(T), alignof(T));
+        T *obj = new (objStart) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value)
+            installFooter(&destroyArray<T>, objStart, 1);
+        return obj;
     }
 
     template <typename T>
     T* makeArrayDefault(size_t count) {
-        return new T[count];
+        T *array = reinterpret_cast<T *>(allocObject(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; i++) new (&array[i]) T;
+        if (!std::is_trivially_destructible<T>::value)
+            installFooter(&destroyArray<T>, reinterpret_cast<char *>(array), count);
+        return array;
     }
 
     template <typename T>
     T* makeArray(size_t count) {
-        return new T[count];
+        T *array = reinterpret_cast<T *>(allocObject(sizeof(T) * count, alignof(T)));
+        for (size_t i = 0; i < count; i++) new (&array[i]) T();
+        if (!std::is_trivially_destructible<T>::value)
+            installFooter(&destroyArray<T>, reinterpret_cast<char *>(array), count);
+        return array;
+    }
+
+    // bytes handed out from heap blocks so far (debug / stats only)
+    size_t heapBytes() const { return mHeapBytes; }
+
+private:
+    using DestroyFn = void (*)(char *, size_t);
+
+    struct Footer {
+        Footer   *mNext;
+        DestroyFn mDestroy;
+        char     *mObject;
+        size_t    mCount;
+    };
+
+    struct Block {
+        Block *mNext;
+    };
+
+    template <typename T>
+    static void destroyArray(char *objStart, size_t count) {
+        T *array = reinterpret_cast<T *>(objStart);
+        while (count) array[--count].~T();
+    }
+
+    char *allocObject(size_t size, size_t alignment) {
+        uintptr_t mask = alignment - 1;
+        uintptr_t start = (reinterpret_cast<uintptr_t>(mCursor) + mask) & ~mask;
+        if (!mCursor || start + size > reinterpret_cast<uintptr_t>(mEnd)) {
+            newBlock(size, alignment);
+            start = (reinterpret_cast<uintptr_t>(mCursor) + mask) & ~mask;
+        }
+        mCursor = reinterpret_cast<char *>(start + size);
+        return reinterpret_cast<char *>(start);
     }
+
+    void installFooter(DestroyFn fn, char *objStart, size_t count);
+    void newBlock(size_t size, size_t alignment);
+
+    char   *mCursor{nullptr};
+    char   *mEnd{nullptr};
+    Block  *mBlocks{nullptr};
+    Footer *mFooters{nullptr};
+    size_t  mNextHeapAlloc;
+    size_t  mHeapBytes{0};
 };
 
 using lottie_image_load_f = unsigned char *(*)(const char *filename, int *x, int *y, int *comp, int req_comp);
@@ -2668,24 +2819,7 @@ struct VImageLoader::Impl {
     */
     void convertToBGRAPremul(unsigned char *bits, int width, int height)
     {
-        int            pixelCount = width * height;
-        unsigned char *pix = bits;
-        for (int i = 0; i < pixelCount; i++) {
-            unsigned char r = pix[0];
-            unsigned char g = pix[1];
-            unsigned char b = pix[2];
-            unsigned char a = pix[3];
-
-            r = (r * a) / 255;
-            g = (g * a) / 255;
-            b = (b * a) / 255;
-
-            pix[0] = b;
-            pix[1] = g;
-            pix[2] = r;
-
-            pix += 4;
-        }
+        vPremultiplyRGBA(reinterpret_cast<uint32_t *>(bits), size_t(width) * height);
     }
 
     void convertToBGRA(unsigned char *bits, int width, int height)
@@ -2749,6 +2883,9 @@ struct LOTModelStat
 
 };
 
+template<typename T>
+inline T lerp(const T& start, const T& end, float t);
+
 template <typename T>
 struct LOTKeyFrameValue {
     T mStartValue;
@@ -2822,9 +2959,9 @@ class LOTVariant
 {
 public:
     using ValueFunc = std::function<float(const FrameInfo &)>;
-    using ColorFunc = std::function<Color(const imlottie::FrameInfo &)>;
-    using PointFunc = std::function<Point(const imlottie::FrameInfo &)>;
-    using SizeFunc = std::function<Size(const imlottie::FrameInfo &)>;
+    using ColorFunc = std::function<imlottie::Color(const imlottie::FrameInfo &)>;
+    using PointFunc = std::function<imlottie::Point(const imlottie::FrameInfo &)>;
+    using SizeFunc = std::function<imlottie::Size(const imlottie::FrameInfo &)>;
 
     LOTVariant(imlottie::Property prop, const ValueFunc &v):mPropery(prop), mTag(Value)
     {
@@ -3099,11 +3236,8 @@ public:
         if(mKeyFrames.back().mEndFrame <= frameNo)
             return mKeyFrames.back().mValue.mEndValue;
 
-        for(const auto &keyFrame : mKeyFrames) {
-            if (frameNo >= keyFrame.mStartFrame && frameNo < keyFrame.mEndFrame)
-                return keyFrame.value(frameNo);
-        }
-        return T();
+        int index = segment(frameNo);
+        return index < 0 ? T() : mKeyFrames[index].value(frameNo);
     }
 
     float angle(int frameNo) const {
@@ -3111,11 +3245,32 @@ public:
             (mKeyFrames.back().mEndFrame <= frameNo) )
             return 0;
 
-        for(const auto &keyFrame : mKeyFrames) {
-            if (frameNo >= keyFrame.mStartFrame && frameNo < keyFrame.mEndFrame)
-                return keyFrame.angle(frameNo);
+        int index = segment(frameNo);
+        return index < 0 ? 0 : mKeyFrames[index].angle(frameNo);
+    }
+
+    // index of the keyframe covering frameNo, -1 if it falls in a gap.
+    // Sequential playback hits the cached segment or the next one, any
+    // other frame is a binary search over the (time ordered) keyframes.
+    // The model is shared between animations, so the cursor is only a hint.
+    int segment(int frameNo) const {
+        int count = int(mKeyFrames.size());
+        int hint = mCursor.load(std::memory_order_relaxed);
+        if (hint < count && covers(hint, frameNo)) return hint;
+        if (hint + 1 < count && covers(hint + 1, frameNo)) {
+            mCursor.store(hint + 1, std::memory_order_relaxed);
+            return hint + 1;
         }
-        return 0;
+
+        auto it = std::upper_bound(mKeyFrames.begin(), mKeyFrames.end(), frameNo,
+                                   [](int frame, const LOTKeyFrame<T> &keyFrame) {
+                                       return frame < keyFrame.mEndFrame;
+                                   });
+        if (it == mKeyFrames.end() || frameNo < it->mStartFrame) return -1;
+
+        int index = int(it - mKeyFrames.begin());
+        mCursor.store(index, std::memory_order_relaxed);
+        return index;
     }
 
     bool changed(int prevFrame, int curFrame) const {
@@ -3128,6 +3283,12 @@ public:
 
 public:
     std::vector<LOTKeyFrame<T>>    mKeyFrames;
+private:
+    bool covers(int index, int frameNo) const {
+        return frameNo >= mKeyFrames[index].mStartFrame &&
+               frameNo < mKeyFrames[index].mEndFrame;
+    }
+    mutable std::atomic<int>       mCursor{0};
 };
 
 template<typename T>
@@ -3502,11 +3663,13 @@ struct LOTAsset
         Image,
         Char
     };
+    ~LOTAsset();
     bool isStatic() const {return mStatic;}
     void setStatic(bool value) {mStatic = value;}
-    VBitmap  bitmap() const {return mBitmap;}
-    void loadImageData(std::string data);
-    void loadImagePath(std::string Path);
+    // decoded on first call and shared through the image cache
+    VBitmap  bitmap() const;
+    // data uri of embedded image or path of external one
+    void setImageSource(std::string source, bool embedded);
     Type                                      mAssetType{Type::Precomp};
     bool                                      mStatic{true};
     std::string                               mRefId; // ref id
@@ -3514,7 +3677,9 @@ struct LOTAsset
     // image asset data
     int                                       mWidth{0};
     int                                       mHeight{0};
-    VBitmap                                   mBitmap;
+    std::string                               mImageSource;
+    std::string                               mImageKey;
+    bool                                      mImageEmbedded{false};
 };
 
 class LottieShapeData
@@ -3577,14 +3742,14 @@ public:
             if(vec.back().mEndFrame <= frameNo)
                 return vec.back().mValue.mEndValue.toPath(path);
 
-            for(const auto &keyFrame : vec) {
-                if (frameNo >= keyFrame.mStartFrame && frameNo < keyFrame.mEndFrame) {
-                    LottieShapeData::lerp(keyFrame.mValue.mStartValue,
-                                          keyFrame.mValue.mEndValue,
-                                          keyFrame.progress(frameNo),
-                                          path);
-                }
-            }
+            int index = animation().segment(frameNo);
+            if (index < 0) return;
+
+            const auto &keyFrame = vec[index];
+            LottieShapeData::lerp(keyFrame.mValue.mStartValue,
+                                  keyFrame.mValue.mEndValue,
+                                  keyFrame.progress(frameNo),
+                                  path);
         }
     }
 };
@@ -4203,8 +4368,22 @@ public:
     const LOTLayerNode * renderTree()const;
     bool render(const Surface &surface);
     void setValue(const std::string &keypath, LOTVariant &value);
+    const std::vector<VRect> &dirtyRects() const { return mDirtyRects; }
+    const RenderTimings &timings() const { return mTimings; }
+private:
+    bool canRenderPartial(const Surface &surface) const;
+    void mergeDirtyRects(const VRect &clip);
 private:
     VBitmap                                     mSurface;
+    std::vector<VRect>                          mDirtyRects;
+    RenderTimings                               mTimings;
+    struct {
+        const void *buffer{nullptr};
+        size_t      width{0};
+        size_t      height{0};
+        size_t      bytesPerLine{0};
+        VRect       drawRegion;
+    }                                           mRetained;
     VMatrix                                     mScaleMatrix;
     VSize                                       mViewSize;
     LOTCompositionData                         *mCompData{nullptr};
@@ -4290,6 +4469,8 @@ public:
     void preprocess(const VRect& clip);
     virtual DrawableList renderList(){ return {};}
     virtual void render(VPainter *painter, const VRle &mask, const VRle &matteRle);
+    virtual VRect renderBounds();
+    virtual void collectDirtyRects(std::vector<VRect> &rects);
     bool hasMatte() { if (mLayerData->mMatteType == MatteType::None) return false; return true; }
     MatteType matteType() const { return mLayerData->mMatteType;}
     bool visible() const;
@@ -4322,6 +4503,8 @@ protected:
     DirtyFlag                                   mDirtyFlag{DirtyFlagBit::All};
     bool                                        mComplexContent{false};
     std::unique_ptr<LOTCApiData>                mCApiData;
+    VRect                                       mLastBounds; // bounds at the last dirty rect collection
+    bool                                        mContentChanged{true};
 };
 
 class LOTCompLayerItem: public LOTLayerItem
@@ -4330,6 +4513,8 @@ public:
     explicit LOTCompLayerItem(LOTLayerData *layerData, VArenaAlloc* allocator);
 
     void render(VPainter *painter, const VRle &mask, const VRle &matteRle) final;
+    VRect renderBounds() final;
+    void collectDirtyRects(std::vector<VRect> &rects) final;
     void buildLayerNode() final;
     bool resolveKeyPath(LOTKeyPath &keyPath, uint depth, LOTVariant &value) override;
 protected:
@@ -4342,6 +4527,7 @@ private:
 private:
     std::vector<LOTLayerItem*>            mLayers;
     std::unique_ptr<LOTClipperItem>       mClipper;
+    VBitmap                               mAlphaBuffer;
 };
 
 class LOTSolidLayerItem: public LOTLayerItem
@@ -4393,9 +4579,11 @@ protected:
     void preprocessStage(const VRect& clip) final;
     void updateContent() final;
 private:
+    void loadTexture();
     LOTDrawable                  mRenderNode;
     VTexture                     mTexture;
     VDrawable                   *mDrawableList{nullptr}; //to work with the Span api
+    bool                         mTextureLoaded{false};
 };
 
 class LOTMaskItem
@@ -4429,6 +4617,7 @@ public:
 public:
     std::vector<LOTMaskItem>   mMasks;
     VRle                       mRle;
+    VRect                      mClip; // clip mRle was built for
     bool                       mStatic{true};
     bool                       mDirty{true};
 };
@@ -4476,11 +4665,18 @@ public:
         return mModel.hasModel() ? mModel.name() : TAG;
     }
     bool resolveKeyPath(LOTKeyPath &keyPath, uint depth, LOTVariant &value) override;
+    // keeps updating this group and its sub groups every frame
+    void markDynamic();
 protected:
     std::vector<LOTContentItem*>   mContents;
     VMatrix                                        mMatrix;
 private:
     LOTProxyModel<LOTGroupData> mModel;
+    // whole subtree is static (parser flags), once it has been updated
+    // with unchanged parent matrix and alpha the update can be skipped.
+    bool                        mStaticSubtree{false};
+    bool                        mSettled{false};
+    size_t                      mSubtreeItems{0};
 };
 
 class LOTPathDataItem : public LOTContentItem
@@ -4879,6 +5075,24 @@ public:
     bool isNeedClear() const { return mNeedClear; }
     void setNeedClear(bool needClear) { mNeedClear = needClear; }
 
+    /**
+    *  @brief Marks the buffer as still holding the frame rendered into it
+    *  by the previous render call of the same Animation.
+    *  Only the regions that changed since that frame get cleared and
+    *  repainted, @see Animation::dirtyRegion() for what was touched.
+    *  The whole draw region is repainted when the buffer, its size or the
+    *  draw region differ from the previous call.
+    *  @param[in] partial true to repaint only the changed regions.
+    *  @note Default is false, every render repaints the whole draw region.
+    */
+    void setPartialUpdate(bool partial) { mPartialUpdate = partial; }
+
+    /**
+    *  @brief Returns true if only the changed regions are repainted.
+    *  @return partial update mode.
+    */
+    bool isPartialUpdate() const { return mPartialUpdate; }
+
     Surface() = default;
 private:
     uint32_t    *mBuffer{nullptr};
@@ -4892,6 +5106,7 @@ private:
         size_t   h{0};
     }mDrawArea;
     bool mNeedClear{true};
+    bool mPartialUpdate{false};
 };
 
 using MarkerList = std::vector<std::tuple<std::string, int , int>>;
@@ -4904,6 +5119,115 @@ using MarkerList = std::vector<std::tuple<std::string, int , int>>;
 
 using LayerInfoList = std::vector<std::tuple<std::string, int , int>>;
 
+/**
+ *  @brief Configures the model cache size.
+ *
+ *  @param[in] cacheSize Maximum number of parsed models kept alive by the
+ *             cache. Zero disables caching and drops every entry.
+ */
+void configureModelCacheSize(size_t cacheSize);
+
+/**
+ *  @brief Reports model cache usage since startup.
+ *
+ *  @param[out] hits    loads served from the cache.
+ *  @param[out] misses  loads that had to parse the resource.
+ *  @param[out] entries models currently held by the cache.
+ */
+void modelCacheStats(size_t &hits, size_t &misses, size_t &entries);
+
+/**
+ *  @brief Configures memory kept by decoded image assets.
+ *
+ *  @param[in] bytes Images not drawn by any layer are dropped, least
+ *             recently used first, while cache holds more than this.
+ *  @note Images decode when a layer first shows them, default budget is 32MB.
+ */
+void configureImageCacheSize(size_t bytes);
+
+/**
+ *  @brief Reports image asset cache usage.
+ *
+ *  @param[out] bytes   decoded pixels held by the cache.
+ *  @param[out] entries images currently held by the cache.
+ *  @param[out] decoded images decoded since startup.
+ */
+void imageCacheStats(size_t &bytes, size_t &entries, size_t &decoded);
+
+/**
+ *  @brief Reports gradient color table cache usage since startup.
+ *
+ *  @param[out] hits gradients drawn with a cached table.
+ *  @param[out] misses gradients whose table was built and cached.
+ *  @param[out] builds tables generated, can exceed misses when threads
+ *              build the same table at once.
+ */
+void gradientCacheStats(size_t &hits, size_t &misses, size_t &builds);
+
+/**
+ *  @brief Configures how many threads rasterize paths.
+ *
+ *  @param[in] count Number of raster threads, zero rasterizes on the
+ *             rendering thread, negative picks it from cpu count.
+ *  @note Takes effect only before the first frame is rendered.
+ */
+void configureRasterThreads(int count);
+
+/**
+ *  @brief Joins the raster threads, next rendered frame starts them again.
+ *
+ *  Call it before the module is unloaded, the threads must not be left to
+ *  static destructors: in a DLL they run under the loader lock, where
+ *  joining a thread deadlocks.
+ *
+ *  @note No animation may be rendering while it runs.
+ */
+void shutdownRasterThreads();
+
+/**
+ *  @brief Configures when mask and clip rle operations are split over raster threads.
+ *
+ *  @param[in] spans Operations on at least twice this many spans are cut into
+ *             bands of rows, each band gets about this many. Zero keeps every
+ *             operation on the rendering thread, default is 4096.
+ *  @note Bands run on threads set by configureRasterThreads().
+ */
+void configureRleBands(size_t spans);
+
+/**
+ *  @brief Configures how scaled down image layers are sampled.
+ *
+ *  @param[in] enable When true image layers drawn smaller than their size are
+ *             box filtered (integer scales) or sampled bilinearly from a
+ *             prebuilt half size copy, otherwise nearest pixel is used like
+ *             for magnified images. Default is false. Power of two shrinks
+ *             draw their half size copy either way, it is exact and faster
+ *             than nearest sampling. Mip levels count in the image cache
+ *             budget.
+ */
+void configureImageSmoothing(bool enable);
+
+/**
+ *  @brief Returns stage times and counters collected since the last reset.
+ *
+ *  @return Readable multi line summary, empty unless built with IMLOTTIE_TRACE.
+ */
+std::string traceSummary();
+
+/**
+ *  @brief Writes collected stage spans and per frame counters as Chrome
+ *         trace json, loads in chrome://tracing or Perfetto.
+ *
+ *  @param[in] path Output file path.
+ *  @return false when the file can't be written or built without IMLOTTIE_TRACE.
+ */
+bool traceExport(const std::string &path);
+
+/**
+ *  @brief Drops collected spans and zeroes the counters.
+ */
+void traceReset();
+
 class Animation {
 public:
 
@@ -4992,6 +5316,22 @@ public:
     */
     void              renderSync(size_t frameNo, Surface surface, bool keepAspectRatio=true);
 
+    /**
+    *  @brief Returns the areas of the surface touched by the last render call.
+    *         With Surface::setPartialUpdate() these are the regions that
+    *         changed since the previous frame, otherwise the whole draw region.
+    *  @return list of rectangles in surface coordinates, empty if the last
+    *          render left the surface untouched.
+    *  @see Surface::setPartialUpdate()
+    */
+    const std::vector<Rect>& dirtyRegion() const;
+
+    /**
+    *  @brief Returns time spent in each stage of the last render call.
+    *  @see configureRasterThreads()
+    */
+    const RenderTimings& renderTimings() const;
+
     /**
     *  @brief Returns root layer of the composition updated with
     *         content of the Lottie resource at frame number @p frameNo.
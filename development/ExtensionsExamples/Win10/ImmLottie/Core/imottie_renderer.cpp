@@ -33,16 +33,255 @@
 #include "stb_image.h"
 
 #include "imlottie_impl.h"
+
+// IMLOTTIE_STANDALONE builds renderer outside ImMobile (tools, other hosts),
+// files are read with standard streams instead of ImmApi storage.
+#if defined(IMLOTTIE_STANDALONE)
+#include <fstream>
+#include <sstream>
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#else
 #include "ImmApiProviderBridge.h"
+#endif
 
+#include <chrono>
 #include <mutex>
 #include <condition_variable>
+#include <thread>
+#include <list>
+
+// Vectorized compositing kernels are picked at compile time, define
+// IMLOTTIE_DISABLE_SIMD to force the scalar reference kernels.
+#if !defined(IMLOTTIE_DISABLE_SIMD)
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMLOTTIE_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM) || defined(_M_ARM64)
+#define IMLOTTIE_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+// IMLOTTIE_TRACE compiles in scoped timers and counters around the
+// pipeline stages, see traceSummary() and traceExport(). Without it the
+// macros below expand to nothing.
+#if defined(IMLOTTIE_TRACE)
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+
+namespace imlottie {
+namespace trace {
+
+enum Stage { Parse, Frame, Update, Rasterize, RleOp, Blend, StageCount };
+
+static const char *stageName(int stage) {
+    static const char *names[StageCount] = {"parse", "frame", "update",
+                                            "rasterize", "rleop", "blend"};
+    return names[stage];
+}
+
+struct Event {
+    int      stage;
+    int      tid;
+    int64_t  start; // ns since first event
+    int64_t  duration;
+};
+
+struct Counters {
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> drawables{0};
+    std::atomic<uint64_t> rleSpans{0};
+    std::atomic<uint64_t> pixelsBlended{0};
+    std::atomic<uint64_t> bytesAllocated{0};
+    std::atomic<uint64_t> itemsUpdated{0};
+    std::atomic<uint64_t> itemsSkipped{0};
+    std::atomic<uint64_t> rleTranslated{0};
+};
+
+// keeps first MAX_EVENTS spans for export, totals cover everything
+class Recorder {
+public:
+    static constexpr size_t MAX_EVENTS = 256 * 1024;
+
+    static Recorder &instance() {
+        static Recorder recorder;
+        return recorder;
+    }
+
+    int64_t now() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - mEpoch).count();
+    }
+
+    void add(int stage, int64_t start, int64_t duration) {
+        mTotal[stage] += uint64_t(duration);
+        mCalls[stage]++;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mEvents.size() < MAX_EVENTS) {
+            mEvents.push_back({stage, threadIndex(), start, duration});
+        } else {
+            mDropped++;
+        }
+    }
+
+    // counter snapshot at the end of every frame
+    void frameDone() {
+        mCounters.frames++;
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mSamples.size() < MAX_EVENTS) {
+            mSamples.push_back({now(), mCounters.drawables.load(), mCounters.rleSpans.load(),
+                                mCounters.pixelsBlended.load(), mCounters.bytesAllocated.load(),
+                                mCounters.itemsSkipped.load()});
+        }
+    }
+
+    Counters &counters() { return mCounters; }
+
+    std::string summary() {
+        const uint64_t frames = mCounters.frames.load();
+        const double   perFrame = frames ? 1.0 / frames : 0.0;
+        char line[160];
+        std::string out;
+
+        snprintf(line, sizeof(line), "frames %" PRIu64 "\n", frames);
+        out += line;
+        for (int i = 0; i < StageCount; i++) {
+            const uint64_t calls = mCalls[i].load();
+            if (!calls) continue;
+            const double ms = mTotal[i].load() / 1e6;
+            snprintf(line, sizeof(line), "%-9s %8" PRIu64 " calls %10.2f ms %8.3f ms/frame\n",
+                     stageName(i), calls, ms, ms * perFrame);
+            out += line;
+        }
+        snprintf(line, sizeof(line),
+                 "per frame: %.1f drawables, %.0f rle spans, %.0f pixels blended, %.0f bytes allocated\n",
+                 mCounters.drawables.load() * perFrame, mCounters.rleSpans.load() * perFrame,
+                 mCounters.pixelsBlended.load() * perFrame, mCounters.bytesAllocated.load() * perFrame);
+        out += line;
+        const uint64_t items = mCounters.itemsUpdated.load() + mCounters.itemsSkipped.load();
+        snprintf(line, sizeof(line), "content items: %.0f per frame, %.1f%% skipped as static\n",
+                 items * perFrame, items ? 100.0 * mCounters.itemsSkipped.load() / items : 0.0);
+        out += line;
+        snprintf(line, sizeof(line), "rle moved instead of rasterized: %.1f per frame\n",
+                 mCounters.rleTranslated.load() * perFrame);
+        out += line;
+        return out;
+    }
+
+    // chrome://tracing and Perfetto json
+    bool exportJson(const std::string &path) {
+        FILE *file = fopen(path.c_str(), "w");
+        if (!file) return false;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        fprintf(file, "{\"traceEvents\":[\n");
+        const char *sep = "";
+        for (const auto &e : mEvents) {
+            fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    sep, stageName(e.stage), e.tid, e.start / 1e3, e.duration / 1e3);
+            sep = ",\n";
+        }
+        for (const auto &s : mSamples) {
+            fprintf(file, "%s{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":0,\"ts\":%.3f,"
+                          "\"args\":{\"drawables\":%" PRIu64 ",\"rleSpans\":%" PRIu64
+                          ",\"pixelsBlended\":%" PRIu64 ",\"bytesAllocated\":%" PRIu64
+                          ",\"itemsSkipped\":%" PRIu64 "}}",
+                    sep, s.time / 1e3, s.drawables, s.rleSpans, s.pixelsBlended, s.bytesAllocated,
+                    s.itemsSkipped);
+            sep = ",\n";
+        }
+        fprintf(file, "\n],\"displayTimeUnit\":\"ms\",\"droppedEvents\":%zu}\n", mDropped);
+        return fclose(file) == 0;
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mEvents.clear();
+        mSamples.clear();
+        mDropped = 0;
+        for (int i = 0; i < StageCount; i++) {
+            mTotal[i] = 0;
+            mCalls[i] = 0;
+        }
+        mCounters.frames = 0;
+        mCounters.drawables = 0;
+        mCounters.rleSpans = 0;
+        mCounters.pixelsBlended = 0;
+        mCounters.bytesAllocated = 0;
+        mCounters.itemsUpdated = 0;
+        mCounters.itemsSkipped = 0;
+        mCounters.rleTranslated = 0;
+    }
+
+private:
+    struct Sample {
+        int64_t  time;
+        uint64_t drawables;
+        uint64_t rleSpans;
+        uint64_t pixelsBlended;
+        uint64_t bytesAllocated;
+        uint64_t itemsSkipped;
+    };
+
+    static int threadIndex() {
+        static std::atomic<int> next{1};
+        thread_local int index = next++;
+        return index;
+    }
+
+    const std::chrono::steady_clock::time_point mEpoch{std::chrono::steady_clock::now()};
+    std::atomic<uint64_t> mTotal[StageCount]{};
+    std::atomic<uint64_t> mCalls[StageCount]{};
+    Counters              mCounters;
+    std::mutex            mMutex;
+    std::vector<Event>    mEvents;
+    std::vector<Sample>   mSamples;
+    size_t                mDropped{0};
+};
+
+class Scope {
+public:
+    explicit Scope(Stage stage) : mStage(stage), mStart(Recorder::instance().now()) {}
+    ~Scope() {
+        Recorder &recorder = Recorder::instance();
+        recorder.add(mStage, mStart, recorder.now() - mStart);
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+private:
+    Stage   mStage;
+    int64_t mStart;
+};
+
+} // namespace trace
+} // namespace imlottie
+
+#define LOTTIE_TRACE_CONCAT_(a, b) a##b
+#define LOTTIE_TRACE_CONCAT(a, b) LOTTIE_TRACE_CONCAT_(a, b)
+#define LOTTIE_TRACE_SCOPE(stage) \
+    imlottie::trace::Scope LOTTIE_TRACE_CONCAT(traceScope, __LINE__)(imlottie::trace::stage)
+#define LOTTIE_TRACE_COUNT(counter, n) \
+    (imlottie::trace::Recorder::instance().counters().counter += uint64_t(n))
+#define LOTTIE_TRACE_FRAME() imlottie::trace::Recorder::instance().frameDone()
+#else
+#define LOTTIE_TRACE_SCOPE(stage)
+#define LOTTIE_TRACE_COUNT(counter, n)
+#define LOTTIE_TRACE_FRAME()
+#endif
 
 namespace imlottie {
     std::shared_ptr<Animation> animationLoad(const char *path) {
-        return Animation::loadFromFile(path, false
-                                                /*not use cache*/
-        );
+        // same json at different sizes shares one parsed model
+        return Animation::loadFromFile(path, true);
     }
     uint16_t animationTotalFrame(const std::shared_ptr<Animation> &anim) {
         return anim->totalFrame();
@@ -56,11 +295,36 @@ namespace imlottie {
         // structure which not save any data
         anim->renderSync(nextFrameIndex, surface);
     }
+    bool animationRenderRetained(const std::shared_ptr<Animation> &anim, int nextFrameIndex, uint32_t *data, int width, int height, int row_pitch,
+                                 int &dirtyX, int &dirtyY, int &dirtyW, int &dirtyH) {
+        // data still holds the last frame rendered by anim, only the
+        // regions which changed since get repainted
+        Surface surface(data, width, height, row_pitch);
+        surface.setPartialUpdate(true);
+        anim->renderSync(nextFrameIndex, surface);
+
+        size_t left = width, top = height, right = 0, bottom = 0;
+        for (const auto &rect : anim->dirtyRegion()) {
+            left = std::min(left, rect.x());
+            top = std::min(top, rect.y());
+            right = std::max(right, rect.x() + rect.w());
+            bottom = std::max(bottom, rect.y() + rect.h());
+        }
+        if (right <= left || bottom <= top) {
+            dirtyX = dirtyY = dirtyW = dirtyH = 0;
+            return false;
+        }
+        dirtyX = int(left);
+        dirtyY = int(top);
+        dirtyW = int(right - left);
+        dirtyH = int(bottom - top);
+        return true;
+    }
 } // ImGui
 
 namespace imlottie {
 
-enum class Operation {Add, Xor};
+enum class Operation {Add, Xor, Substract};
 struct VRleHelper {
     size_t      alloc {0};
     size_t      size {0};
@@ -68,12 +332,19 @@ struct VRleHelper {
 };
 static void rleIntersectWithRle(VRleHelper *, int, int, VRleHelper *, VRleHelper *);
 static void rleIntersectWithRect(const VRect &, VRleHelper *, VRleHelper *);
-static void rleOpGeneric(VRleHelper *, VRleHelper *, VRleHelper *, Operation op);
-static void rleSubstractWithRle(VRleHelper *, VRleHelper *, VRleHelper *);
+static void rleRowOp(const VRle::Span *, size_t, const VRle::Span *, size_t,
+                     std::vector<VRle::Span> &, Operation op);
+// rows of rle ops are split over raster threads in at most this many bands
+static constexpr size_t MAX_RLE_BANDS = 8;
+static size_t rleBandCount(size_t spans);
+static void rleParallel(size_t count, const std::function<void(size_t)> &job);
 static inline uchar divBy255(int x) { return (x + (x >> 8) + 0x80) >> 8; }
 inline static void copyArrayToVector(const VRle::Span *span, size_t count, std::vector<VRle::Span> &v) {
     // make sure enough memory available
-    if (v.capacity() < v.size() + count) v.reserve(v.size() + count);
+    if (v.capacity() < v.size() + count) {
+        LOTTIE_TRACE_COUNT(bytesAllocated, (v.size() + count - v.capacity()) * sizeof(VRle::Span));
+        v.reserve(v.size() + count);
+    }
     std::copy(span, span + count, std::back_inserter(v));
 }
 void VRle::VRleData::addSpan(const VRle::Span *span, size_t count) {
@@ -91,23 +362,19 @@ void VRle::VRleData::setBbox(const VRect &bbox) const {
 void VRle::VRleData::reset() {
     mSpans.clear();
     mBbox = VRect();
-    mOffset = VPoint();
     mBboxDirty = false;
 }
 void VRle::VRleData::clone(const VRle::VRleData &o) {
     *this = o;
 }
 void VRle::VRleData::translate(const VPoint &p) {
-    // take care of last offset if applied
-    mOffset = p - mOffset;
-    int x = mOffset.x();
-    int y = mOffset.y();
+    int x = p.x();
+    int y = p.y();
     for (auto &i : mSpans) {
         i.x = i.x + x;
         i.y = i.y + y;
     }
-    updateBbox();
-    mBbox.translate(mOffset.x(), mOffset.y());
+    if (!mBboxDirty) mBbox.translate(x, y);
 }
 void VRle::VRleData::addRect(const VRect &rect) {
     int x = rect.left();
@@ -179,57 +446,175 @@ void VRle::VRleData::opIntersect(const VRect &r, VRle::VRleSpanCb cb,
         tresult.size = 0;
     }
 }
+/*
+* Span buffers of rle boolean ops. Buffers go back to a per thread free
+* list when the op is done, so ops running every frame (masks, clippers)
+* keep writing into storage grown by earlier frames instead of growing a
+* fresh vector chunk by chunk.
+*/
+class VRleScratch {
+public:
+    VRleScratch() {
+        auto &list = freeList();
+        if (!list.empty()) {
+            mSpans = std::move(list.back());
+            list.pop_back();
+        }
+    }
+    ~VRleScratch() {
+        auto &list = freeList();
+        if (list.size() < MAX_FREE) {
+            mSpans.clear();
+            list.push_back(std::move(mSpans));
+        }
+    }
+    VRleScratch(const VRleScratch &) = delete;
+    VRleScratch &operator=(const VRleScratch &) = delete;
+    std::vector<VRle::Span> &spans() {
+        return mSpans;
+    }
+private:
+    static constexpr size_t MAX_FREE = 16;
+    static std::vector<std::vector<VRle::Span>> &freeList() {
+        static thread_local std::vector<std::vector<VRle::Span>> list;
+        return list;
+    }
+    std::vector<VRle::Span> mSpans;
+};
+/*
+* res = a + b, a ^ b or a - b, spans of both lists sorted by row.
+* rows only one list has are copied (or dropped for b when substracting),
+* shared rows are combined by rleRowOp.
+*/
+static void rleMergeSpans(const VRle::Span *a, size_t aSize, const VRle::Span *b,
+                          size_t bSize, std::vector<VRle::Span> &out, Operation op) {
+    const VRle::Span *aPtr = a;
+    const VRle::Span *aEnd = a + aSize;
+    const VRle::Span *bPtr = b;
+    const VRle::Span *bEnd = b + bSize;
+    const bool        keepB = op != Operation::Substract;
+    while (aPtr != aEnd && bPtr != bEnd) {
+        const VRle::Span *aStart = aPtr;
+        const VRle::Span *bStart = bPtr;
+        if (aPtr->y < bPtr->y) {
+            while (aPtr != aEnd && aPtr->y < bPtr->y) aPtr++;
+            copyArrayToVector(aStart, size_t(aPtr - aStart), out);
+        } else if (bPtr->y < aPtr->y) {
+            while (bPtr != bEnd && bPtr->y < aPtr->y) bPtr++;
+            if (keepB) copyArrayToVector(bStart, size_t(bPtr - bStart), out);
+        } else {
+            const short y = aPtr->y;
+            while (aPtr != aEnd && aPtr->y == y) aPtr++;
+            while (bPtr != bEnd && bPtr->y == y) bPtr++;
+            rleRowOp(aStart, size_t(aPtr - aStart), bStart, size_t(bPtr - bStart), out, op);
+        }
+    }
+    // copy the rest
+    if (aPtr != aEnd) copyArrayToVector(aPtr, size_t(aEnd - aPtr), out);
+    if (bPtr != bEnd && keepB) copyArrayToVector(bPtr, size_t(bEnd - bPtr), out);
+}
+// res = a & b, spans of both lists sorted by row
+static void rleIntersectSpans(const VRle::Span *a, size_t aSize, const VRle::Span *b,
+                              size_t bSize, std::vector<VRle::Span> &out) {
+    VRleHelper                  result, source, clip;
+    std::array<VRle::Span, 256> array;
+    // setup the tresult object
+    result.size = array.size();
+    result.alloc = array.size();
+    result.spans = array.data();
+    // setup tmp object
+    source.size = aSize;
+    source.spans = const_cast<VRle::Span *>(a);
+    // setup tmp clip object
+    clip.size = bSize;
+    clip.spans = const_cast<VRle::Span *>(b);
+    // run till all the spans are processed
+    while (source.size) {
+        rleIntersectWithRle(&clip, 0, 0, &source, &result);
+        if (result.size) {
+            copyArrayToVector(result.spans, result.size, out);
+        }
+        result.size = 0;
+    }
+}
+static void rleAssignSpans(std::vector<VRle::Span> &to, const std::vector<VRle::Span> &from) {
+    if (to.capacity() < from.size()) {
+        LOTTIE_TRACE_COUNT(bytesAllocated, (from.size() - to.capacity()) * sizeof(VRle::Span));
+    }
+    to.assign(from.begin(), from.end());
+}
+/*
+* Runs a boolean op over two sorted span lists into res. Every op works
+* row by row, so large inputs are cut into bands of rows that raster
+* threads process at the same time, each into its own scratch buffer,
+* and the bands are joined in row order.
+*/
+template <typename Op>
+static void rleSpansOp(const std::vector<VRle::Span> &a, const std::vector<VRle::Span> &b,
+                       std::vector<VRle::Span> &res, Op op) {
+    const size_t bands = rleBandCount(a.size() + b.size());
+    if (bands < 2) {
+        VRleScratch scratch;
+        op(a.data(), a.size(), b.data(), b.size(), scratch.spans());
+        rleAssignSpans(res, scratch.spans());
+        return;
+    }
+    // band edges at rows splitting the longer list evenly
+    const auto &                       longer = a.size() >= b.size() ? a : b;
+    std::array<int, MAX_RLE_BANDS + 1> rows;
+    rows[0] = std::numeric_limits<int>::min();
+    rows[bands] = std::numeric_limits<int>::max();
+    for (size_t i = 1; i < bands; i++) rows[i] = longer[i * longer.size() / bands].y;
+    auto rowStart = [](const std::vector<VRle::Span> &spans, int row) {
+        return size_t(std::lower_bound(spans.begin(), spans.end(), row,
+                                       [](const VRle::Span &span, int y) {
+                                           return span.y < y;
+                                       }) - spans.begin());
+    };
+    std::array<VRleScratch, MAX_RLE_BANDS> scratch;
+    rleParallel(bands, [&](size_t i) {
+        const size_t a1 = rowStart(a, rows[i]), a2 = rowStart(a, rows[i + 1]);
+        const size_t b1 = rowStart(b, rows[i]), b2 = rowStart(b, rows[i + 1]);
+        op(a.data() + a1, a2 - a1, b.data() + b1, b2 - b1, scratch[i].spans());
+    });
+    size_t total = 0;
+    for (size_t i = 0; i < bands; i++) total += scratch[i].spans().size();
+    res.clear();
+    if (res.capacity() < total) {
+        LOTTIE_TRACE_COUNT(bytesAllocated, (total - res.capacity()) * sizeof(VRle::Span));
+        res.reserve(total);
+    }
+    for (size_t i = 0; i < bands; i++) {
+        res.insert(res.end(), scratch[i].spans().begin(), scratch[i].spans().end());
+    }
+}
 // res = a - b;
 void VRle::VRleData::opSubstract(const VRle::VRleData &a,
                                  const VRle::VRleData &b) {
+    LOTTIE_TRACE_SCOPE(RleOp);
     // if two rle are disjoint
     if (!a.bbox().intersects(b.bbox())) {
         mSpans = a.mSpans;
     } else {
-        VRle::Span *      aPtr = const_cast<VRle::Span *>(a.mSpans.data());
-        const VRle::Span *aEnd = a.mSpans.data() + a.mSpans.size();
-        VRle::Span *      bPtr = const_cast<VRle::Span *>(b.mSpans.data());
-        const VRle::Span *bEnd = b.mSpans.data() + b.mSpans.size();
-        // 1. forward till both y intersect
-        while ((aPtr != aEnd) && (aPtr->y < bPtr->y)) aPtr++;
-        size_t sizeA = size_t(aPtr - a.mSpans.data());
-        if (sizeA) copyArrayToVector(a.mSpans.data(), sizeA, mSpans);
-        // 2. forward b till it intersect with a.
-        while ((bPtr != bEnd) && (bPtr->y < aPtr->y)) bPtr++;
-        size_t sizeB = size_t(bPtr - b.mSpans.data());
-        // 2. calculate the intersect region
-        VRleHelper                  tresult, aObj, bObj;
-        std::array<VRle::Span, 256> array;
-        // setup the tresult object
-        tresult.size = array.size();
-        tresult.alloc = array.size();
-        tresult.spans = array.data();
-        // setup a object
-        aObj.size = a.mSpans.size() - sizeA;
-        aObj.spans = aPtr;
-        // setup b object
-        bObj.size = b.mSpans.size() - sizeB;
-        bObj.spans = bPtr;
-        // run till all the spans are processed
-        while (aObj.size && bObj.size) {
-            rleSubstractWithRle(&aObj, &bObj, &tresult);
-            if (tresult.size) {
-                copyArrayToVector(tresult.spans, tresult.size, mSpans);
-            }
-            tresult.size = 0;
-        }
-        // 3. copy the rest of a
-        if (aObj.size) copyArrayToVector(aObj.spans, aObj.size, mSpans);
+        rleSpansOp(a.mSpans, b.mSpans, mSpans,
+                   [](const VRle::Span *a, size_t aSize, const VRle::Span *b, size_t bSize,
+                      std::vector<VRle::Span> &out) {
+                       rleMergeSpans(a, aSize, b, bSize, out, Operation::Substract);
+                   });
     }
     mBboxDirty = true;
 }
 void VRle::VRleData::opGeneric(const VRle::VRleData &a, const VRle::VRleData &b,
                                OpCode code) {
-    // This routine assumes, obj1(span_y) < obj2(span_y).
-    // reserve some space for the result vector.
-    mSpans.reserve(a.mSpans.size() + b.mSpans.size());
+    LOTTIE_TRACE_SCOPE(RleOp);
     // if two rle are disjoint
     if (!a.bbox().intersects(b.bbox())) {
+        // reserve some space for the result vector.
+        if (mSpans.capacity() < a.mSpans.size() + b.mSpans.size()) {
+            LOTTIE_TRACE_COUNT(bytesAllocated,
+                               (a.mSpans.size() + b.mSpans.size() - mSpans.capacity()) * sizeof(VRle::Span));
+        }
+        mSpans.reserve(a.mSpans.size() + b.mSpans.size());
         if (a.mSpans[0].y < b.mSpans[0].y) {
             copyArrayToVector(a.mSpans.data(), a.mSpans.size(), mSpans);
             copyArrayToVector(b.mSpans.data(), b.mSpans.size(), mSpans);
@@ -238,31 +623,6 @@ void VRle::VRleData::opGeneric(const VRle::VRleData &a, const VRle::VRleData &b,
             copyArrayToVector(a.mSpans.data(), a.mSpans.size(), mSpans);
         }
     } else {
-        VRle::Span *      aPtr = const_cast<VRle::Span *>(a.mSpans.data());
-        const VRle::Span *aEnd = a.mSpans.data() + a.mSpans.size();
-        VRle::Span *      bPtr = const_cast<VRle::Span *>(b.mSpans.data());
-        const VRle::Span *bEnd = b.mSpans.data() + b.mSpans.size();
-        // 1. forward a till it intersects with b
-        while ((aPtr != aEnd) && (aPtr->y < bPtr->y)) aPtr++;
-        size_t sizeA = size_t(aPtr - a.mSpans.data());
-        if (sizeA) copyArrayToVector(a.mSpans.data(), sizeA, mSpans);
-        // 2. forward b till it intersects with a
-        while ((bPtr != bEnd) && (bPtr->y < aPtr->y)) bPtr++;
-        size_t sizeB = size_t(bPtr - b.mSpans.data());
-        if (sizeB) copyArrayToVector(b.mSpans.data(), sizeB, mSpans);
-        // 3. calculate the intersect region
-        VRleHelper                  tresult, aObj, bObj;
-        std::array<VRle::Span, 256> array;
-        // setup the tresult object
-        tresult.size = array.size();
-        tresult.alloc = array.size();
-        tresult.spans = array.data();
-        // setup a object
-        aObj.size = a.mSpans.size() - sizeA;
-        aObj.spans = aPtr;
-        // setup b object
-        bObj.size = b.mSpans.size() - sizeB;
-        bObj.spans = bPtr;
         Operation op = Operation::Add;
         switch (code) {
         case OpCode::Add:
@@ -272,24 +632,14 @@ void VRle::VRleData::opGeneric(const VRle::VRleData &a, const VRle::VRleData &b,
         op = Operation::Xor;
         break;
         }
-        // run till all the spans are processed
-        while (aObj.size && bObj.size) {
-            rleOpGeneric(&aObj, &bObj, &tresult, op);
-            if (tresult.size) {
-                copyArrayToVector(tresult.spans, tresult.size, mSpans);
-            }
-            tresult.size = 0;
-        }
-        // 3. copy the rest
-        if (bObj.size) copyArrayToVector(bObj.spans, bObj.size, mSpans);
-        if (aObj.size) copyArrayToVector(aObj.spans, aObj.size, mSpans);
+        rleSpansOp(a.mSpans, b.mSpans, mSpans,
+                   [op](const VRle::Span *a, size_t aSize, const VRle::Span *b, size_t bSize,
+                        std::vector<VRle::Span> &out) {
+                       rleMergeSpans(a, aSize, b, bSize, out, op);
+                   });
     }
     mBboxDirty = true;
 }
-static void rle_cb(size_t count, const VRle::Span *spans, void *userData) {
-    auto vector = static_cast<std::vector<VRle::Span> *>(userData);
-    copyArrayToVector(spans, count, *vector);
-}
 void opIntersectHelper(const VRle::VRleData &obj1, const VRle::VRleData &obj2,
                        VRle::VRleSpanCb cb, void *userData) {
     VRleHelper                  result, source, clip;
@@ -315,7 +665,8 @@ void opIntersectHelper(const VRle::VRleData &obj1, const VRle::VRleData &obj2,
 }
 void VRle::VRleData::opIntersect(const VRle::VRleData &obj1,
                                  const VRle::VRleData &obj2) {
-    opIntersectHelper(obj1, obj2, rle_cb, &mSpans);
+    LOTTIE_TRACE_SCOPE(RleOp);
+    rleSpansOp(obj1.mSpans, obj2.mSpans, mSpans, rleIntersectSpans);
     updateBbox();
 }
 #define VMIN(a, b) ((a) < (b) ? (a) : (b))
@@ -497,7 +848,6 @@ size_t bufferToRle(uchar *buffer, int size, int offsetX, int y, VRle::Span *out)
     size_t count = 0;
     uchar  value = buffer[0];
     int    curIndex = 0;
-    size = offsetX < 0 ? size + offsetX : size;
     for (int i = 0; i < size; i++) {
         uchar curValue = buffer[0];
         if (value != curValue) {
@@ -523,120 +873,34 @@ size_t bufferToRle(uchar *buffer, int size, int offsetX, int y, VRle::Span *out)
     }
     return count;
 }
-static void rleOpGeneric(VRleHelper *a, VRleHelper *b, VRleHelper *result,
-                         Operation op) {
-    std::array<VRle::Span, 256> temp;
-    VRle::Span *                out = result->spans;
-    size_t                      available = result->alloc;
-    VRle::Span *                aPtr = a->spans;
-    VRle::Span *                aEnd = a->spans + a->size;
-    VRle::Span *                bPtr = b->spans;
-    VRle::Span *                bEnd = b->spans + b->size;
-    while (available && aPtr < aEnd && bPtr < bEnd) {
-        if (aPtr->y < bPtr->y) {
-            *out++ = *aPtr++;
-            available--;
-        } else if (bPtr->y < aPtr->y) {
-            *out++ = *bPtr++;
-            available--;
-        } else {
-            // same y
-            VRle::Span *aStart = aPtr;
-            VRle::Span *bStart = bPtr;
-            int y = aPtr->y;
-            while (aPtr < aEnd && aPtr->y == y) aPtr++;
-            while (bPtr < bEnd && bPtr->y == y) bPtr++;
-            int aLength = (aPtr - 1)->x + (aPtr - 1)->len;
-            int bLength = (bPtr - 1)->x + (bPtr - 1)->len;
-            int offset = std::min(aStart->x, bStart->x);
-            std::array<uchar, 1024> array = { {
-                    0
-                }
-            }
-            ;
-            blit(aStart, (aPtr - aStart), array.data(), -offset);
-            if (op == Operation::Add)
-                blitSrcOver(bStart, (bPtr - bStart), array.data(), -offset); else if (op == Operation::Xor)
-                blitXor(bStart, (bPtr - bStart), array.data(), -offset);
-            VRle::Span *tResult = temp.data();
-            size_t size = bufferToRle(array.data(), std::max(aLength, bLength),
-                                      offset, y, tResult);
-            if (available >= size) {
-                while (size--) {
-                    *out++ = *tResult++;
-                    available--;
-                }
-            } else {
-                aPtr = aStart;
-                bPtr = bStart;
-                break;
-            }
-        }
-    }
-    // update the span list that yet to be processed
-    a->spans = aPtr;
-    a->size = aEnd - aPtr;
-    // update the clip list that yet to be processed
-    b->spans = bPtr;
-    b->size = bEnd - bPtr;
-    // update the result
-    result->size = result->alloc - available;
-}
-static void rleSubstractWithRle(VRleHelper *a, VRleHelper *b,
-                                VRleHelper *result) {
-    std::array<VRle::Span, 256> temp;
-    VRle::Span *                out = result->spans;
-    size_t                      available = result->alloc;
-    VRle::Span *                aPtr = a->spans;
-    VRle::Span *                aEnd = a->spans + a->size;
-    VRle::Span *                bPtr = b->spans;
-    VRle::Span *                bEnd = b->spans + b->size;
-    while (available && aPtr < aEnd && bPtr < bEnd) {
-        if (aPtr->y < bPtr->y) {
-            *out++ = *aPtr++;
-            available--;
-        } else if (bPtr->y < aPtr->y) {
-            bPtr++;
-        } else {
-            // same y
-            VRle::Span *aStart = aPtr;
-            VRle::Span *bStart = bPtr;
-            int y = aPtr->y;
-            while (aPtr < aEnd && aPtr->y == y) aPtr++;
-            while (bPtr < bEnd && bPtr->y == y) bPtr++;
-            int aLength = (aPtr - 1)->x + (aPtr - 1)->len;
-            int bLength = (bPtr - 1)->x + (bPtr - 1)->len;
-            int offset = std::min(aStart->x, bStart->x);
-            std::array<uchar, 1024> array = { {
-                    0
-                }
-            }
-            ;
-            blit(aStart, (aPtr - aStart), array.data(), -offset);
-            blitDestinationOut(bStart, (bPtr - bStart), array.data(), -offset);
-            VRle::Span *tResult = temp.data();
-            size_t size = bufferToRle(array.data(), std::max(aLength, bLength),
-                                      offset, y, tResult);
-            if (available >= size) {
-                while (size--) {
-                    *out++ = *tResult++;
-                    available--;
-                }
-            } else {
-                aPtr = aStart;
-                bPtr = bStart;
-                break;
-            }
-        }
+/*
+* Combines one row of a with the same row of b through a coverage buffer
+* as wide as both, buffers are per thread and only grow.
+*/
+static void rleRowOp(const VRle::Span *a, size_t aCount, const VRle::Span *b,
+                     size_t bCount, std::vector<VRle::Span> &out, Operation op) {
+    static thread_local std::vector<uchar>      coverage;
+    static thread_local std::vector<VRle::Span> row;
+    const int offset = std::min(a->x, b->x);
+    const int end = std::max(a[aCount - 1].x + a[aCount - 1].len, b[bCount - 1].x + b[bCount - 1].len);
+    const int width = end - offset;
+    if (width <= 0) return;
+    coverage.assign(size_t(width), 0);
+    if (row.size() < size_t(width)) row.resize(size_t(width));
+    blit(const_cast<VRle::Span *>(a), int(aCount), coverage.data(), -offset);
+    switch (op) {
+    case Operation::Add:
+    blitSrcOver(const_cast<VRle::Span *>(b), int(bCount), coverage.data(), -offset);
+    break;
+    case Operation::Xor:
+    blitXor(const_cast<VRle::Span *>(b), int(bCount), coverage.data(), -offset);
+    break;
+    case Operation::Substract:
+    blitDestinationOut(const_cast<VRle::Span *>(b), int(bCount), coverage.data(), -offset);
+    break;
     }
-    // update the span list that yet to be processed
-    a->spans = aPtr;
-    a->size = size_t(aEnd - aPtr);
-    // update the clip list that yet to be processed
-    b->spans = bPtr;
-    b->size = size_t(bEnd - bPtr);
-    // update the result
-    result->size = result->alloc - available;
+    size_t size = bufferToRle(coverage.data(), width, offset, a->y, row.data());
+    copyArrayToVector(row.data(), size, out);
 }
 VRle VRle::toRle(const VRect &rect) {
     if (rect.empty()) return VRle();
@@ -645,23 +909,16 @@ VRle VRle::toRle(const VRect &rect) {
     return result;
 }
 /*
-* this api makes use of thread_local temporary
-* buffer to avoid creating intermediate temporary rle buffer
-* the scratch buffer object will grow its size on demand
-* so that future call won't need any more memory allocation.
-* this function is thread safe as it uses thread_local variable
-* which is unique per thread.
+* intersection is built in a thread_local scratch buffer and copied back,
+* so a unique rle keeps its storage and needs no allocation once grown.
 */
-static thread_local VRle::VRleData Scratch_Object;
 void VRle::operator&=(const VRle &o) {
     if (empty()) return;
     if (o.empty()) {
         reset();
         return;
     }
-    Scratch_Object.reset();
-    Scratch_Object.opIntersect(d.read(), o.d.read());
-    d.write() = Scratch_Object;
+    d.write().opIntersect(d.read(), o.d.read());
 }
 template <typename T>
 class dyn_array {
@@ -874,6 +1131,7 @@ void FTOutline::end() {
 static void rleGenerationCb(int count, const SW_FT_Span *spans, void *user) {
     VRle *rle = static_cast<VRle *>(user);
     auto *rleSpan = reinterpret_cast<const VRle::Span *>(spans);
+    LOTTIE_TRACE_COUNT(rleSpans, count);
     rle->addSpan(rleSpan, count);
 }
 static void bboxCb(int x, int y, int w, int h, void *user) {
@@ -976,6 +1234,8 @@ struct VRleTask {
         sw_ft_grays_raster.raster_render(nullptr, &params);
     }
     void operator()(FTOutline &outRef, SW_FT_Stroker &stroker) {
+        LOTTIE_TRACE_SCOPE(Rasterize);
+        LOTTIE_TRACE_COUNT(drawables, 1);
         if (mPath.points().size() > SHRT_MAX ||
             mPath.points().size() + mPath.segments() > SHRT_MAX) {
             return;
@@ -1012,28 +1272,244 @@ struct VRleTask {
 }
 ;
 using VTask = std::shared_ptr<VRleTask>;
-class RleTaskScheduler {
+// item of raster queues, a path to rasterize or a band of an rle op
+struct VJob {
+    VTask                 task;
+    std::function<void()> band;
+};
+template <typename Task>
+class TaskQueue {
+    using lock_t = std::unique_lock<std::mutex>;
+    std::deque<Task>          _q;
+    bool                      _done {
+        false
+    }
+    ;
+    std::mutex                _mutex;
+    std::condition_variable   _ready;
 public:
-    FTOutline     outlineRef {
+    bool try_pop(Task &task) {
+        lock_t lock {
+            _mutex, std::try_to_lock
+        }
+        ;
+        if (!lock || _q.empty()) return false;
+        task = std::move(_q.front());
+        _q.pop_front();
+        return true;
+    }
+    bool try_push(Task &&task) {
+        {
+            lock_t lock {
+                _mutex, std::try_to_lock
+            }
+            ;
+            if (!lock) return false;
+            _q.push_back(std::move(task));
+        }
+        _ready.notify_one();
+        return true;
+    }
+    void done() {
+        {
+            lock_t lock {
+                _mutex
+            }
+            ;
+            _done = true;
+        }
+        _ready.notify_all();
+    }
+    // opens the queue again after done(), workers are joined by then
+    void reset() {
+        lock_t lock {
+            _mutex
+        }
+        ;
+        _done = false;
+    }
+    bool pop(Task &task) {
+        lock_t lock {
+            _mutex
+        }
+        ;
+        while (_q.empty() && !_done) _ready.wait(lock);
+        if (_q.empty()) return false;
+        task = std::move(_q.front());
+        _q.pop_front();
+        return true;
+    }
+    void push(Task &&task) {
+        {
+            lock_t lock {
+                _mutex
+            }
+            ;
+            _q.push_back(std::move(task));
+        }
+        _ready.notify_one();
+    }
+}
+;
+/*
+ * Rasterization runs on a pool of workers, each owning its own FTOutline
+ * and stroker. A worker first tries to steal from its siblings' queues
+ * before blocking on its own, and the caller only blocks when it asks
+ * the SharedRle for the result. With a single hardware thread the task
+ * is executed inline on the caller.
+ * Workers start with the first task and are joined by stop(), they must
+ * not be left to the static destructor: in a DLL it runs under the loader
+ * lock, where joining threads deadlocks. Next task starts them again.
+ */
+class RleTaskScheduler {
+    const unsigned                  _count {
+        workerCount()
+    }
+    ;
+    std::vector<std::thread>        _threads;
+    std::vector<TaskQueue<VJob>>    _q {
+        _count
+    }
+    ;
+    std::atomic<unsigned>           _index {
+        0
+    }
+    ;
+    FTOutline                       outlineRef {
+    }
+    ;
+    SW_FT_Stroker                   stroker;
+    std::mutex                      _inlineMutex;
+    std::mutex                      _threadsMutex;
+    std::atomic<bool>               _running {
+        false
     }
     ;
-    SW_FT_Stroker stroker;
+    static unsigned workerCount() {
+        if (threadsOverride() >= 0) return unsigned(threadsOverride());
+        unsigned count = std::thread::hardware_concurrency();
+        return count > 1 ? count : 0;
+    }
+    void run(unsigned i) {
+        FTOutline     outline;
+        SW_FT_Stroker workerStroker;
+        SW_FT_Stroker_New(&workerStroker);
+        VJob job;
+        while (true) {
+            bool success = false;
+            for (unsigned n = 0; n != _count * 2; ++n) {
+                if (_q[(i + n) % _count].try_pop(job)) {
+                    success = true;
+                    break;
+                }
+            }
+            if (!success && !_q[i].pop(job)) break;
+            if (job.task) {
+                (*job.task)(outline, workerStroker);
+            } else {
+                job.band();
+            }
+            job = VJob();
+        }
+        SW_FT_Stroker_Done(workerStroker);
+    }
+    void push(VJob &&job) {
+        if (!_running.load(std::memory_order_acquire)) start();
+        auto i = _index++;
+        for (unsigned n = 0; n != _count; ++n) {
+            if (_q[(i + n) % _count].try_push(std::move(job))) return;
+        }
+        _q[i % _count].push(std::move(job));
+    }
+    void start() {
+        std::lock_guard<std::mutex> lock(_threadsMutex);
+        if (_running.load(std::memory_order_relaxed)) return;
+        for (auto &e : _q) e.reset();
+        for (unsigned n = 0; n != _count; ++n) {
+            _threads.emplace_back([this, n] {
+                run(n);
+            }
+            );
+        }
+        _running.store(true, std::memory_order_release);
+    }
+    RleTaskScheduler() {
+        SW_FT_Stroker_New(&stroker);
+    }
 public:
     static RleTaskScheduler &instance() {
         static RleTaskScheduler singleton;
         return singleton;
     }
-    RleTaskScheduler() {
-        SW_FT_Stroker_New(&stroker);
+    // read once, when the singleton is created
+    static int &threadsOverride() {
+        static int count = -1;
+        return count;
     }
     ~RleTaskScheduler() {
+        stop();
         SW_FT_Stroker_Done(stroker);
     }
+    // workers finish queued tasks and exit, nothing may be rendering
+    void stop() {
+        std::lock_guard<std::mutex> lock(_threadsMutex);
+        if (!_running.load(std::memory_order_relaxed)) return;
+        for (auto &e : _q) e.done();
+        for (auto &e : _threads) e.join();
+        _threads.clear();
+        _running.store(false, std::memory_order_release);
+    }
     void process(VTask task) {
-        (*task)(outlineRef, stroker);
+        if (_count == 0) {
+            ::std::lock_guard<::std::mutex> lock(_inlineMutex);
+            (*task)(outlineRef, stroker);
+            return;
+        }
+        push(VJob{std::move(task), nullptr});
+    }
+    unsigned workers() const {
+        return _count;
+    }
+    // runs job(0) .. job(count - 1) on workers and the caller, returns when all are done.
+    // caller takes whatever the workers did not start, so it never waits on a busy queue.
+    void parallel(size_t count, const std::function<void(size_t)> &job) {
+        struct State {
+            std::atomic<size_t>     next {0};
+            size_t                  done {0};
+            std::mutex              mutex;
+            std::condition_variable finished;
+        };
+        auto state = std::make_shared<State>();
+        auto work = [state, count, &job]() {
+            size_t i;
+            while ((i = state->next++) < count) {
+                job(i);
+                std::lock_guard<std::mutex> lock(state->mutex);
+                if (++state->done == count) state->finished.notify_one();
+            }
+        };
+        const size_t helpers = std::min<size_t>(count - 1, _count);
+        for (size_t n = 0; n < helpers; ++n) push(VJob{nullptr, work});
+        work();
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (state->done != count) state->finished.wait(lock);
     }
 }
 ;
+// smallest op, in spans of both rles, worth a second band
+static size_t &rleBandSpans() {
+    static size_t spans = 4096;
+    return spans;
+}
+static size_t rleBandCount(size_t spans) {
+    const size_t perBand = rleBandSpans();
+    if (!perBand || spans < 2 * perBand) return 1;
+    const size_t threads = RleTaskScheduler::instance().workers() + 1;
+    return std::min({spans / perBand, threads, MAX_RLE_BANDS});
+}
+static void rleParallel(size_t count, const std::function<void(size_t)> &job) {
+    RleTaskScheduler::instance().parallel(count, job);
+}
 struct VRasterizer::VRasterizerImpl {
     VRleTask mTask;
     VRle &    rle() {
@@ -1048,6 +1524,10 @@ VRle VRasterizer::rle() {
     if (!d) return VRle();
     return d->rle();
 }
+void VRasterizer::translate(const VPoint &offset) {
+    if (!d) return;
+    d->rle().translate(offset);
+}
 void VRasterizer::init() {
     if (!d) d = std::make_shared<VRasterizerImpl>();
 }
@@ -1634,25 +2114,50 @@ void VPath::VPathData::addPath(const VPathData &path, const VMatrix *m) {
     m_segments += segment;
     mLengthDirty = true;
 }
+#if defined(IMLOTTIE_TRACE)
+// counts blended pixels on the way to the real blend function
+static void traceBlendSpans(size_t count, const VRle::Span *spans, void *userData) {
+    size_t pixels = 0;
+    for (size_t i = 0; i < count; i++) pixels += spans[i].len;
+    LOTTIE_TRACE_COUNT(pixelsBlended, pixels);
+    static_cast<VSpanData *>(userData)->mUnclippedBlendFunc(count, spans, userData);
+}
+static VRle::VRleSpanCb blendSpanFunc(const VSpanData &) { return &traceBlendSpans; }
+#else
+static VRle::VRleSpanCb blendSpanFunc(const VSpanData &data) { return data.mUnclippedBlendFunc; }
+#endif
 void VPainter::drawRle(const VPoint &, const VRle &rle) {
     if (rle.empty()) return;
     // mSpanData.updateSpanFunc();
     if (!mSpanData.mUnclippedBlendFunc) return;
+    LOTTIE_TRACE_SCOPE(Blend);
     // do draw after applying clip.
-    rle.intersect(mSpanData.clipRect(), mSpanData.mUnclippedBlendFunc,
+    rle.intersect(mSpanData.clipRect(), blendSpanFunc(mSpanData),
                   &mSpanData);
 }
 void VPainter::drawRle(const VRle &rle, const VRle &clip) {
     if (rle.empty() || clip.empty()) return;
     if (!mSpanData.mUnclippedBlendFunc) return;
-    rle.intersect(clip, mSpanData.mUnclippedBlendFunc, &mSpanData);
+    LOTTIE_TRACE_SCOPE(Blend);
+    VRect clipRect = mSpanData.clipRect();
+    if (clipRect.contains(rle.boundingRect())) {
+        rle.intersect(clip, blendSpanFunc(mSpanData), &mSpanData);
+    } else {
+        // the clip rect is smaller than the rasterized area (partial
+        // repaint, offscreen buffers), keep spans inside it.
+        (rle & clip).intersect(clipRect, blendSpanFunc(mSpanData),
+                               &mSpanData);
+    }
 }
 static void fillRect(const VRect &r, VSpanData *data) {
-    auto x1 = std::max(r.x(), 0);
-    auto x2 = std::min(r.x() + r.width(), data->mDrawableSize.width());
-    auto y1 = std::max(r.y(), 0);
-    auto y2 = std::min(r.y() + r.height(), data->mDrawableSize.height());
+    VRect clip = data->clipRect();
+    auto x1 = std::max(r.x(), clip.left());
+    auto x2 = std::min(r.x() + r.width(), clip.right());
+    auto y1 = std::max(r.y(), clip.top());
+    auto y2 = std::min(r.y() + r.height(), clip.bottom());
     if (x2 <= x1 || y2 <= y1) return;
+    LOTTIE_TRACE_SCOPE(Blend);
+    LOTTIE_TRACE_COUNT(pixelsBlended, size_t(x2 - x1) * size_t(y2 - y1));
     const int  nspans = 256;
     VRle::Span spans[nspans];
     int y = y1;
@@ -1685,17 +2190,33 @@ VPainter::VPainter(VBitmap *buffer) {
     begin(buffer);
 }
 bool VPainter::begin(VBitmap *buffer) {
+    static std::once_flag blendInit;
+    std::call_once(blendInit, vInitBlendFunctions);
     mBuffer.prepare(buffer);
     mSpanData.init(&mBuffer);
     // TODO find a better api to clear the surface
     mBuffer.clear();
     return true;
 }
+bool VPainter::begin(VBitmap *buffer, const VPoint &origin) {
+    begin(buffer);
+    mSpanData.setBufferOrigin(origin);
+    return true;
+}
 void VPainter::end() {
 }
 void VPainter::setDrawRegion(const VRect &region) {
     mSpanData.setDrawRegion(region);
 }
+void VPainter::setClipRect(const VRect &rect) {
+    mSpanData.setClipRect(rect);
+}
+void VPainter::clear() {
+    VRect clip = mSpanData.clipRect();
+    if (clip.empty()) return;
+    for (int y = clip.top(); y < clip.bottom(); ++y)
+        memset(mSpanData.buffer(clip.x(), y), 0, size_t(clip.width()) * 4);
+}
 void VPainter::setBrush(const VBrush &brush) {
     mSpanData.setup(brush);
 }
@@ -1761,9 +2282,39 @@ float VInterpolator::GetSlope(float aT, float aA1, float aA2) {
     return 3.0f * A(aA1, aA2) * aT * aT + 2.0f * B(aA1, aA2) * aT + C(aA1);
 }
 float VInterpolator::value(float aX) const {
+    if (mHasLut && aX >= 0.0f && aX <= 1.0f) {
+        float pos = aX * kLutSize;
+        int   index = std::min(int(pos), kLutSize - 1);
+        float frac = pos - float(index);
+        return mLut[index] + (mLut[index + 1] - mLut[index]) * frac;
+    }
+    return exactValue(aX);
+}
+float VInterpolator::exactValue(float aX) const {
     if (mX1 == mY1 && mX2 == mY2) return aX;
     return CalcBezier(GetTForX(aX), mY1, mY2);
 }
+bool VInterpolator::buildLut() {
+    mHasLut = false;
+    // linear curve is cheaper than any table
+    if (mX1 == mY1 && mX2 == mY2) return false;
+
+    for (int i = 0; i <= kLutSize; ++i) {
+        mLut[i] = exactValue(float(i) / kLutSize);
+    }
+    // lerp error peaks between samples, off the middle where the curve
+    // bends unevenly (near the ends), so check quarters of every interval
+    // and keep a margin for the peak falling between them
+    for (int i = 0; i < kLutSize; ++i) {
+        for (float frac : {0.25f, 0.5f, 0.75f}) {
+            float exact = exactValue((float(i) + frac) / kLutSize);
+            float lerped = mLut[i] + (mLut[i + 1] - mLut[i]) * frac;
+            if (std::fabs(exact - lerped) > kLutTolerance * 0.9f) return false;
+        }
+    }
+    mHasLut = true;
+    return true;
+}
 float VInterpolator::GetTForX(float aX) const {
     // Find interval where t lies
     float              intervalStart = 0.0;
@@ -1821,6 +2372,39 @@ float VInterpolator::BinarySubdivide(float aX, float aA, float aB) const {
            ++i < SUBDIVISION_MAX_ITERATIONS);
     return currentT;
 }
+VArenaAlloc::VArenaAlloc(char *block, size_t blockSize, size_t firstHeapAllocation)
+    : mCursor(block), mEnd(block ? block + blockSize : nullptr),
+      mNextHeapAlloc(firstHeapAllocation ? firstHeapAllocation : 1024) {
+}
+VArenaAlloc::~VArenaAlloc() {
+    // destructors first (newest object first), then give the blocks back.
+    for (Footer *f = mFooters; f; f = f->mNext) f->mDestroy(f->mObject, f->mCount);
+    while (mBlocks) {
+        Block *next = mBlocks->mNext;
+        ::operator delete(mBlocks);
+        mBlocks = next;
+    }
+}
+void VArenaAlloc::installFooter(DestroyFn fn, char *objStart, size_t count) {
+    auto footer = reinterpret_cast<Footer *>(allocObject(sizeof(Footer), alignof(Footer)));
+    footer->mNext = mFooters;
+    footer->mDestroy = fn;
+    footer->mObject = objStart;
+    footer->mCount = count;
+    mFooters = footer;
+}
+void VArenaAlloc::newBlock(size_t size, size_t alignment) {
+    constexpr size_t kMaxBlockSize = 64 * 1024;
+    size_t headerSize = sizeof(Block) + alignof(std::max_align_t);
+    size_t blockSize = std::max(mNextHeapAlloc, size + alignment + headerSize);
+    mNextHeapAlloc = std::min(mNextHeapAlloc * 2, kMaxBlockSize);
+    auto block = static_cast<Block *>(::operator new(blockSize));
+    block->mNext = mBlocks;
+    mBlocks = block;
+    mCursor = reinterpret_cast<char *>(block) + sizeof(Block);
+    mEnd = reinterpret_cast<char *>(block) + blockSize;
+    mHeapBytes += blockSize;
+}
 VImageLoader::VImageLoader() : mImpl(std::make_unique<VImageLoader::Impl>()) {
 }
 VImageLoader::~VImageLoader() {
@@ -1849,82 +2433,124 @@ VBitmap::Format VRasterBuffer::prepare(VBitmap *image) {
     mFormat = image->format();
     return mFormat;
 }
+/*
+* Color tables of gradients, shared by all drawables and threads. Entries
+* are spread over shards by a hash of stops and alpha, every shard has its
+* own lock and least recently used order, so painters on different threads
+* rarely wait for each other and a table used every frame is never evicted
+* by one used once.
+*/
 class VGradientCache {
 public:
     struct CacheInfo : public VColorTable {
-        inline CacheInfo(VGradientStops s) : stops(std::move(s)) {
+        inline CacheInfo(VGradientStops s, float o) : stops(std::move(s)), opacity(o) {
         }
         VGradientStops stops;
+        float          opacity;
     }
     ;
     using VCacheData = std::shared_ptr<const CacheInfo>;
-    using VCacheKey = int64_t;
-    using VGradientColorTableHash =
-        std::unordered_multimap<VCacheKey, VCacheData>;
     bool generateGradientColorTable(const VGradientStops &stops, float alpha,
                                     uint32_t *colorTable, int size);
     VCacheData getBuffer(const VGradient &gradient) {
-        VCacheKey             hash_val = 0;
-        VCacheData            info;
-        const VGradientStops &stops = gradient.mStops;
-        for (uint i = 0; i < stops.size() && i <= 2; i++)
-            hash_val += VCacheKey(stops[i].second.premulARGB() * gradient.alpha()); {
-            ::std::lock_guard<::std::mutex> guard(mMutex);
-            size_t count = mCache.count(hash_val);
-            if (!count) {
-                // key is not present in the hash
-                info = addCacheElement(hash_val, gradient);
-            } else if (count == 1) {
-                auto search = mCache.find(hash_val);
-                if (search->second->stops == stops) {
-                    info = search->second;
-                } else {
-                    // didn't find an exact match
-                    info = addCacheElement(hash_val, gradient);
-                }
-            } else {
-                // we have a multiple data with same key
-                auto range = mCache.equal_range(hash_val);
-                for (auto it = range.first; it != range.second; ++it) {
-                    if (it->second->stops == stops) {
-                        info = it->second;
-                        break;
-                    }
-                }
-                if (!info) {
-                    // didn't find an exact match
-                    info = addCacheElement(hash_val, gradient);
+        const size_t hash = cacheKey(gradient.mStops, gradient.alpha());
+        Shard &      shard = mShards[hash % SHARDS];
+        {
+            ::std::lock_guard<::std::mutex> guard(shard.mutex);
+            if (VCacheData info = find(shard, hash, gradient)) {
+                mHits++;
+                return info;
+            }
+        }
+        // build without holding the shard, it takes longer than a lookup
+        auto entry = std::make_shared<CacheInfo>(gradient.mStops, gradient.alpha());
+        entry->alpha = generateGradientColorTable(
+            gradient.mStops, gradient.alpha(), entry->buffer32,
+            VGradient::colorTableSize);
+        mBuilds++;
+
+        ::std::lock_guard<::std::mutex> guard(shard.mutex);
+        // another thread may have added the same table meanwhile
+        if (VCacheData info = find(shard, hash, gradient)) {
+            mHits++;
+            return info;
+        }
+        mMisses++;
+        shard.lru.push_front({hash, entry});
+        shard.hash.emplace(hash, shard.lru.begin());
+        if (shard.lru.size() > SHARD_SIZE) {
+            auto range = shard.hash.equal_range(shard.lru.back().hash);
+            for (auto it = range.first; it != range.second; ++it) {
+                if (it->second == std::prev(shard.lru.end())) {
+                    shard.hash.erase(it);
+                    break;
                 }
             }
+            shard.lru.pop_back();
         }
-        return info;
+        return entry;
+    }
+    void stats(size_t &hits, size_t &misses, size_t &builds) const {
+        hits = mHits;
+        misses = mMisses;
+        builds = mBuilds;
     }
     static VGradientCache &instance() {
         static VGradientCache CACHE;
         return CACHE;
     }
-protected:
-    uint       maxCacheSize() const {
-        return 60;
-    }
-    VCacheData addCacheElement(VCacheKey hash_val, const VGradient &gradient) {
-        if (mCache.size() == maxCacheSize()) {
-            uint count = maxCacheSize() / 10;
-            while (count--) {
-                mCache.erase(mCache.begin());
+private:
+    static constexpr size_t SHARDS = 8;
+    static constexpr size_t SHARD_SIZE = 8;
+    struct Entry {
+        size_t     hash;
+        VCacheData info;
+    };
+    struct Shard {
+        std::list<Entry>                                            lru;
+        std::unordered_multimap<size_t, std::list<Entry>::iterator> hash;
+        ::std::mutex                                                mutex;
+    };
+    // FNV-1a over every stop offset and color and the alpha
+    static size_t cacheKey(const VGradientStops &stops, float alpha) {
+        uint64_t hash = 14695981039346656037ull;
+        auto     mix = [&hash](uint32_t value) {
+            for (int i = 0; i < 4; i++) {
+                hash ^= (value >> (i * 8)) & 0xff;
+                hash *= 1099511628211ull;
+            }
+        };
+        auto bits = [](float value) {
+            uint32_t out;
+            memcpy(&out, &value, sizeof(out));
+            return out;
+        };
+        for (const auto &stop : stops) {
+            mix(bits(stop.first));
+            mix(uint32_t(stop.second.alpha()) << 24 | uint32_t(stop.second.red()) << 16 |
+                uint32_t(stop.second.green()) << 8 | stop.second.blue());
+        }
+        mix(bits(alpha));
+        return size_t(hash ^ (hash >> 32));
+    }
+    // caller holds shard.mutex
+    static VCacheData find(Shard &shard, size_t hash, const VGradient &gradient) {
+        auto range = shard.hash.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            const VCacheData &info = it->second->info;
+            if (info->opacity == gradient.alpha() && info->stops == gradient.mStops) {
+                // move to the front of the lru list.
+                shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+                return info;
             }
         }
-        auto cache_entry = std::make_shared<CacheInfo>(gradient.mStops);
-        cache_entry->alpha = generateGradientColorTable(
-            gradient.mStops, gradient.alpha(), cache_entry->buffer32,
-            VGradient::colorTableSize);
-        mCache.insert(std::make_pair(hash_val, cache_entry));
-        return cache_entry;
+        return nullptr;
     }
-private:
     VGradientCache() = default;
-    VGradientColorTableHash mCache;
-    ::std::mutex              mMutex;
+    std::array<Shard, SHARDS> mShards;
+    std::atomic<size_t>       mHits{0};
+    std::atomic<size_t>       mMisses{0};
+    std::atomic<size_t>       mBuilds{0};
 }
 ;
 #define FIXPT_BITS 8
@@ -1967,7 +2593,9 @@ static uint32_t gradientPixelFixed(const VGradientData *grad, int fixed_pos) {
     int ipos = (fixed_pos + (FIXPT_SIZE / 2)) >> FIXPT_BITS;
     return grad->mColorTable[gradientClamp(grad, ipos)];
 }
-void memfill32(uint32_t *dest, uint32_t value, int length) {
+// scalar fill, reference of the vector ones in Tools/simd_conform
+#if !defined(IMLOTTIE_SSE2) && !defined(IMLOTTIE_NEON) || defined(IMLOTTIE_CONFORM)
+static void memfill32_C(uint32_t *dest, uint32_t value, int length) {
     int n;
     if (length <= 0) return;
     // Cute hack to align future memcopy operation
@@ -2003,12 +2631,303 @@ void memfill32(uint32_t *dest, uint32_t value, int length) {
     while (--n > 0);
     }
 }
-void fetch_linear_gradient(uint32_t *buffer, const Operator *op,
-                           const VSpanData *data, int y, int x, int length) {
-    float                t, inc;
-    const VGradientData *gradient = &data->mGradient;
-    bool  affine = true;
-    float rx = 0, ry = 0;
+#endif
+#if defined(IMLOTTIE_SSE2)
+static void memfill32_SSE2(uint32_t *dest, uint32_t value, int length) {
+    if (length <= 0) return;
+    // head until 16 byte aligned, then 16 pixels per iteration
+    while (length && (uintptr_t(dest) & 0xF)) {
+        *dest++ = value;
+        length--;
+    }
+    __m128i v = _mm_set1_epi32(int(value));
+    for (; length >= 16; length -= 16, dest += 16) {
+        _mm_store_si128((__m128i *)(dest), v);
+        _mm_store_si128((__m128i *)(dest + 4), v);
+        _mm_store_si128((__m128i *)(dest + 8), v);
+        _mm_store_si128((__m128i *)(dest + 12), v);
+    }
+    for (; length >= 4; length -= 4, dest += 4) _mm_store_si128((__m128i *)dest, v);
+    while (length--) *dest++ = value;
+}
+#elif defined(IMLOTTIE_NEON)
+static void memfill32_NEON(uint32_t *dest, uint32_t value, int length) {
+    if (length <= 0) return;
+    uint32x4_t v = vdupq_n_u32(value);
+    for (; length >= 16; length -= 16, dest += 16) {
+        vst1q_u32(dest, v);
+        vst1q_u32(dest + 4, v);
+        vst1q_u32(dest + 8, v);
+        vst1q_u32(dest + 12, v);
+    }
+    for (; length >= 4; length -= 4, dest += 4) vst1q_u32(dest, v);
+    while (length--) *dest++ = value;
+}
+#endif
+void memfill32(uint32_t *dest, uint32_t value, int length) {
+#if defined(IMLOTTIE_SSE2)
+    memfill32_SSE2(dest, value, length);
+#elif defined(IMLOTTIE_NEON)
+    memfill32_NEON(dest, value, length);
+#else
+    memfill32_C(dest, value, length);
+#endif
+}
+static void fetchLinearFixed_C(const VGradientData *gradient, uint32_t *buffer,
+                               int length, int t_fixed, int inc_fixed) {
+    while (length--) {
+        *buffer++ = gradientPixelFixed(gradient, t_fixed);
+        t_fixed += inc_fixed;
+    }
+}
+static void fetchRadial_C(uint32_t *buffer, uint32_t *end, const Operator *op,
+                          const VSpanData *data, float det, float delta_det,
+                          float delta_delta_det, float b, float delta_b);
+// Gradient fetchers below do the position math for 4 pixels per step and
+// look the colors up one by one (there is no gather before AVX2). Table
+// size is a power of two, so repeat and reflect become masks and linear
+// results match gradientPixelFixed exactly. Radial lanes run their own
+// determinant recurrence, which rounds a little differently than the
+// scalar one and can land on the neighbouring table entry, so radial
+// gradients may differ from scalar builds by up to 2 per channel
+// (Tools/simd_conform checks both).
+static_assert((VGradient::colorTableSize & (VGradient::colorTableSize - 1)) == 0,
+              "gradient spread masks need a power of two table");
+#if defined(IMLOTTIE_SSE2)
+static inline __m128i v_gradient_clamp_sse2(const VGradientData *grad, __m128i ipos)
+{
+    const int size = VGradient::colorTableSize;
+    if (grad->mSpread == VGradient::Spread::Repeat) {
+        return _mm_and_si128(ipos, _mm_set1_epi32(size - 1));
+    } else if (grad->mSpread == VGradient::Spread::Reflect) {
+        const __m128i limit = _mm_set1_epi32(2 * size - 1);
+        __m128i       m = _mm_and_si128(ipos, limit);
+        // second half of the period runs back, limit - 1 - m == m ^ (limit - 1)
+        __m128i back = _mm_cmpgt_epi32(m, _mm_set1_epi32(size - 1));
+        return _mm_xor_si128(m, _mm_and_si128(back, limit));
+    }
+    const __m128i last = _mm_set1_epi32(size - 1);
+    ipos = _mm_and_si128(ipos, _mm_cmpgt_epi32(ipos, _mm_setzero_si128()));
+    __m128i over = _mm_cmpgt_epi32(ipos, last);
+    return _mm_or_si128(_mm_andnot_si128(over, ipos), _mm_and_si128(over, last));
+}
+
+static inline void v_gradient_lookup_sse2(const VGradientData *grad, __m128i ipos,
+                                          uint32_t *buffer)
+{
+    alignas(16) int32_t index[4];
+    _mm_store_si128((__m128i *)index, v_gradient_clamp_sse2(grad, ipos));
+    buffer[0] = grad->mColorTable[index[0]];
+    buffer[1] = grad->mColorTable[index[1]];
+    buffer[2] = grad->mColorTable[index[2]];
+    buffer[3] = grad->mColorTable[index[3]];
+}
+
+static void fetchLinearFixed_SSE2(const VGradientData *gradient, uint32_t *buffer,
+                                  int length, int t_fixed, int inc_fixed)
+{
+    if (length >= 4) {
+        const __m128i half = _mm_set1_epi32(FIXPT_SIZE / 2);
+        const __m128i step = _mm_set1_epi32(inc_fixed * 4);
+        __m128i       t = _mm_setr_epi32(t_fixed, t_fixed + inc_fixed, t_fixed + 2 * inc_fixed,
+                                         t_fixed + 3 * inc_fixed);
+        for (; length >= 4; length -= 4, buffer += 4) {
+            v_gradient_lookup_sse2(gradient, _mm_srai_epi32(_mm_add_epi32(t, half), FIXPT_BITS),
+                                   buffer);
+            t = _mm_add_epi32(t, step);
+        }
+        t_fixed = _mm_cvtsi128_si32(t);
+    }
+    fetchLinearFixed_C(gradient, buffer, length, t_fixed, inc_fixed);
+}
+
+static void fetchRadial_SSE2(uint32_t *buffer, uint32_t *end, const Operator *op,
+                             const VSpanData *data, float det, float delta_det,
+                             float delta_delta_det, float b, float delta_b)
+{
+    if (end - buffer < 4) {
+        fetchRadial_C(buffer, end, op, data, det, delta_det, delta_delta_det, b, delta_b);
+        return;
+    }
+    // lanes start on the next four pixels of the scalar recurrence
+    alignas(16) float lanes[3][4];
+    for (int i = 0; i < 4; i++) {
+        lanes[0][i] = det;
+        lanes[1][i] = delta_det;
+        lanes[2][i] = b;
+        det += delta_det;
+        delta_det += delta_delta_det;
+        b += delta_b;
+    }
+    __m128       vdet = _mm_load_ps(lanes[0]);
+    __m128       vdelta = _mm_load_ps(lanes[1]);
+    __m128       vb = _mm_load_ps(lanes[2]);
+    const __m128 step_delta = _mm_set1_ps(4 * delta_delta_det);
+    const __m128 step_det = _mm_set1_ps(6 * delta_delta_det);
+    const __m128 step_b = _mm_set1_ps(4 * delta_b);
+    const __m128 four = _mm_set1_ps(4);
+    const __m128 scale = _mm_set1_ps(float(VGradient::colorTableSize - 1));
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 fradius = _mm_set1_ps(data->mGradient.radial.fradius);
+    const __m128 dr = _mm_set1_ps(op->radial.dr);
+    for (; end - buffer >= 4; buffer += 4) {
+        __m128 w = _mm_sub_ps(_mm_sqrt_ps(vdet), vb);
+        v_gradient_lookup_sse2(&data->mGradient,
+                               _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(w, scale), half)), buffer);
+        if (op->radial.extended) {
+            __m128  inside = _mm_and_ps(_mm_cmpge_ps(vdet, zero),
+                                        _mm_cmpge_ps(_mm_add_ps(fradius, _mm_mul_ps(dr, w)), zero));
+            __m128i colors = _mm_loadu_si128((const __m128i *)buffer);
+            _mm_storeu_si128((__m128i *)buffer, _mm_and_si128(colors, _mm_castps_si128(inside)));
+        }
+        vdet = _mm_add_ps(vdet, _mm_add_ps(_mm_mul_ps(four, vdelta), step_det));
+        vdelta = _mm_add_ps(vdelta, step_delta);
+        vb = _mm_add_ps(vb, step_b);
+    }
+    fetchRadial_C(buffer, end, op, data, _mm_cvtss_f32(vdet), _mm_cvtss_f32(vdelta),
+                  delta_delta_det, _mm_cvtss_f32(vb), delta_b);
+}
+#elif defined(IMLOTTIE_NEON)
+static inline int32x4_t v_gradient_clamp_neon(const VGradientData *grad, int32x4_t ipos)
+{
+    const int size = VGradient::colorTableSize;
+    if (grad->mSpread == VGradient::Spread::Repeat) {
+        return vandq_s32(ipos, vdupq_n_s32(size - 1));
+    } else if (grad->mSpread == VGradient::Spread::Reflect) {
+        const int32x4_t limit = vdupq_n_s32(2 * size - 1);
+        int32x4_t       m = vandq_s32(ipos, limit);
+        // second half of the period runs back, limit - 1 - m == m ^ (limit - 1)
+        uint32x4_t back = vcgtq_s32(m, vdupq_n_s32(size - 1));
+        return veorq_s32(m, vandq_s32(vreinterpretq_s32_u32(back), limit));
+    }
+    return vminq_s32(vmaxq_s32(ipos, vdupq_n_s32(0)), vdupq_n_s32(size - 1));
+}
+
+static inline void v_gradient_lookup_neon(const VGradientData *grad, int32x4_t ipos,
+                                          uint32_t *buffer)
+{
+    int32_t index[4];
+    vst1q_s32(index, v_gradient_clamp_neon(grad, ipos));
+    buffer[0] = grad->mColorTable[index[0]];
+    buffer[1] = grad->mColorTable[index[1]];
+    buffer[2] = grad->mColorTable[index[2]];
+    buffer[3] = grad->mColorTable[index[3]];
+}
+
+static inline float32x4_t v_sqrt_neon(float32x4_t x)
+{
+#if defined(__aarch64__) || defined(_M_ARM64)
+    return vsqrtq_f32(x);
+#else
+    // x * 1/sqrt(x) with two newton steps, zero stays zero
+    float32x4_t r = vrsqrteq_f32(x);
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(x, r), r));
+    r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(x, r), r));
+    float32x4_t s = vmulq_f32(x, r);
+    return vbslq_f32(vceqq_f32(x, vdupq_n_f32(0)), x, s);
+#endif
+}
+
+static void fetchLinearFixed_NEON(const VGradientData *gradient, uint32_t *buffer,
+                                  int length, int t_fixed, int inc_fixed)
+{
+    if (length >= 4) {
+        const int32x4_t half = vdupq_n_s32(FIXPT_SIZE / 2);
+        const int32x4_t step = vdupq_n_s32(inc_fixed * 4);
+        const int32_t   start[4] = {t_fixed, t_fixed + inc_fixed, t_fixed + 2 * inc_fixed,
+                                    t_fixed + 3 * inc_fixed};
+        int32x4_t       t = vld1q_s32(start);
+        for (; length >= 4; length -= 4, buffer += 4) {
+            v_gradient_lookup_neon(gradient, vshrq_n_s32(vaddq_s32(t, half), FIXPT_BITS), buffer);
+            t = vaddq_s32(t, step);
+        }
+        t_fixed = vgetq_lane_s32(t, 0);
+    }
+    fetchLinearFixed_C(gradient, buffer, length, t_fixed, inc_fixed);
+}
+
+static void fetchRadial_NEON(uint32_t *buffer, uint32_t *end, const Operator *op,
+                             const VSpanData *data, float det, float delta_det,
+                             float delta_delta_det, float b, float delta_b)
+{
+    if (end - buffer < 4) {
+        fetchRadial_C(buffer, end, op, data, det, delta_det, delta_delta_det, b, delta_b);
+        return;
+    }
+    // lanes start on the next four pixels of the scalar recurrence
+    float lanes[3][4];
+    for (int i = 0; i < 4; i++) {
+        lanes[0][i] = det;
+        lanes[1][i] = delta_det;
+        lanes[2][i] = b;
+        det += delta_det;
+        delta_det += delta_delta_det;
+        b += delta_b;
+    }
+    float32x4_t       vdet = vld1q_f32(lanes[0]);
+    float32x4_t       vdelta = vld1q_f32(lanes[1]);
+    float32x4_t       vb = vld1q_f32(lanes[2]);
+    const float32x4_t step_delta = vdupq_n_f32(4 * delta_delta_det);
+    const float32x4_t step_det = vdupq_n_f32(6 * delta_delta_det);
+    const float32x4_t step_b = vdupq_n_f32(4 * delta_b);
+    const float32x4_t scale = vdupq_n_f32(float(VGradient::colorTableSize - 1));
+    const float32x4_t half = vdupq_n_f32(0.5f);
+    const float32x4_t zero = vdupq_n_f32(0);
+    const float32x4_t fradius = vdupq_n_f32(data->mGradient.radial.fradius);
+    const float32x4_t dr = vdupq_n_f32(op->radial.dr);
+    for (; end - buffer >= 4; buffer += 4) {
+        // negative determinants of extended gradients are masked below
+        float32x4_t root = v_sqrt_neon(op->radial.extended ? vmaxq_f32(vdet, zero) : vdet);
+        float32x4_t w = vsubq_f32(root, vb);
+        v_gradient_lookup_neon(&data->mGradient,
+                               vcvtq_s32_f32(vaddq_f32(vmulq_f32(w, scale), half)), buffer);
+        if (op->radial.extended) {
+            uint32x4_t inside = vandq_u32(vcgeq_f32(vdet, zero),
+                                          vcgeq_f32(vaddq_f32(fradius, vmulq_f32(dr, w)), zero));
+            vst1q_u32(buffer, vandq_u32(vld1q_u32(buffer), inside));
+        }
+        vdet = vaddq_f32(vdet, vaddq_f32(vmulq_n_f32(vdelta, 4), step_det));
+        vdelta = vaddq_f32(vdelta, step_delta);
+        vb = vaddq_f32(vb, step_b);
+    }
+    fetchRadial_C(buffer, end, op, data, vgetq_lane_f32(vdet, 0), vgetq_lane_f32(vdelta, 0),
+                  delta_delta_det, vgetq_lane_f32(vb, 0), delta_b);
+}
+#endif
+static void fetchLinearFixed(const VGradientData *gradient, uint32_t *buffer, int length,
+                             int t_fixed, int inc_fixed) {
+#if defined(IMLOTTIE_SSE2)
+    fetchLinearFixed_SSE2(gradient, buffer, length, t_fixed, inc_fixed);
+#elif defined(IMLOTTIE_NEON)
+    fetchLinearFixed_NEON(gradient, buffer, length, t_fixed, inc_fixed);
+#else
+    fetchLinearFixed_C(gradient, buffer, length, t_fixed, inc_fixed);
+#endif
+}
+static void fetchRadial(uint32_t *buffer, uint32_t *end, const Operator *op,
+                        const VSpanData *data, float det, float delta_det,
+                        float delta_delta_det, float b, float delta_b) {
+#if defined(IMLOTTIE_SSE2)
+    fetchRadial_SSE2(buffer, end, op, data, det, delta_det, delta_delta_det, b, delta_b);
+#elif defined(IMLOTTIE_NEON)
+    fetchRadial_NEON(buffer, end, op, data, det, delta_det, delta_delta_det, b, delta_b);
+#else
+    fetchRadial_C(buffer, end, op, data, det, delta_det, delta_delta_det, b, delta_b);
+#endif
+}
+using LinearFixedFetch = void (*)(const VGradientData *, uint32_t *, int, int, int);
+using RadialFetch = void (*)(uint32_t *, uint32_t *, const Operator *, const VSpanData *,
+                             float, float, float, float, float);
+// span math shared by the fetchers, inner loop passed in so
+// Tools/simd_conform can run the scalar one on the same span
+static void fetchLinearGradient(uint32_t *buffer, const Operator *op,
+                                const VSpanData *data, int y, int x, int length,
+                                LinearFixedFetch fetchFixed) {
+    float                t, inc;
+    const VGradientData *gradient = &data->mGradient;
+    bool  affine = true;
+    float rx = 0, ry = 0;
     if (op->linear.l == 0) {
         t = inc = 0;
     } else {
@@ -2033,13 +2952,8 @@ void fetch_linear_gradient(uint32_t *buffer, const Operator *op,
             if (t + inc * length < float(INT_MAX >> (FIXPT_BITS + 1)) &&
                 t + inc * length > float(INT_MIN >> (FIXPT_BITS + 1))) {
                 // we can use fixed point math
-                int t_fixed = int(t * FIXPT_SIZE);
-                int inc_fixed = int(inc * FIXPT_SIZE);
-                while (buffer < end) {
-                    *buffer = gradientPixelFixed(gradient, t_fixed);
-                    t_fixed += inc_fixed;
-                    ++buffer;
-                }
+                fetchFixed(gradient, buffer, length, int(t * FIXPT_SIZE),
+                           int(inc * FIXPT_SIZE));
             } else {
                 // we have to fall back to float math
                 while (buffer < end) {
@@ -2080,9 +2994,9 @@ static inline void getRadialGradientValues(RadialGradientValues *v,
     v->inv2a = 1 / (2 * v->a);
     v->extended = !vIsZero(gradient.radial.fradius) || v->a <= 0;
 }
-static void fetch(uint32_t *buffer, uint32_t *end, const Operator *op,
-                  const VSpanData *data, float det, float delta_det,
-                  float delta_delta_det, float b, float delta_b) {
+static void fetchRadial_C(uint32_t *buffer, uint32_t *end, const Operator *op,
+                          const VSpanData *data, float det, float delta_det,
+                          float delta_delta_det, float b, float delta_b) {
     if (op->radial.extended) {
         while (buffer < end) {
             uint32_t result = 0;
@@ -2109,8 +3023,9 @@ static void fetch(uint32_t *buffer, uint32_t *end, const Operator *op,
 static inline float radialDeterminant(float a, float b, float c) {
     return (b * b) - (4 * a * c);
 }
-void fetch_radial_gradient(uint32_t *buffer, const Operator *op,
-                           const VSpanData *data, int y, int x, int length) {
+static void fetchRadialGradient(uint32_t *buffer, const Operator *op,
+                                const VSpanData *data, int y, int x, int length,
+                                RadialFetch fetch) {
     // avoid division by zero
     if (vIsZero(op->radial.a)) {
         memfill32(buffer, 0, length);
@@ -2184,6 +3099,14 @@ void fetch_radial_gradient(uint32_t *buffer, const Operator *op,
         }
     }
 }
+void fetch_linear_gradient(uint32_t *buffer, const Operator *op,
+                           const VSpanData *data, int y, int x, int length) {
+    fetchLinearGradient(buffer, op, data, y, x, length, fetchLinearFixed);
+}
+void fetch_radial_gradient(uint32_t *buffer, const Operator *op,
+                           const VSpanData *data, int y, int x, int length) {
+    fetchRadialGradient(buffer, op, data, y, x, length, fetchRadial);
+}
 extern CompositionFunction             COMP_functionForMode_C[];
 extern CompositionFunctionSolid        COMP_functionForModeSolid_C[];
 static const CompositionFunction *     functionForMode = COMP_functionForMode_C;
@@ -2230,10 +3153,7 @@ static void blendColorARGB(size_t count, const VRle::Span *spans,
             if (spans->coverage == 255) {
                 memfill32(target, color, spans->len);
             } else {
-                uint c = BYTE_MUL(color, spans->coverage);
-                int  ialpha = 255 - spans->coverage;
-                for (int i = 0; i < spans->len; ++i)
-                    target[i] = c + BYTE_MUL(target[i], ialpha);
+                op.funcSolid(target, spans->len, color, spans->coverage);
             }
             ++spans;
         }
@@ -2395,6 +3315,250 @@ static void      blend_transformed_argb(size_t count, const VRle::Span *spans, v
         }
     }
 }
+// a + b == 256
+static inline uint interpolate_pixel(uint x, uint a, uint y, uint b) {
+    uint t = (x & 0x00ff00ff) * a + (y & 0x00ff00ff) * b;
+    t = (t >> 8) & 0x00ff00ff;
+    x = ((x >> 8) & 0x00ff00ff) * a + ((y >> 8) & 0x00ff00ff) * b;
+    return (x & 0xff00ff00) | t;
+}
+// minified affine images, the texture is already the mip level closest
+// above the target size so four taps are enough.
+static void blend_transformed_bilinear_argb(size_t count, const VRle::Span *spans,
+                                            void *userData) {
+    VSpanData *data = reinterpret_cast<VSpanData *>(userData);
+    Operator   op = getOperator(data, spans, count);
+    uint       buffer[buffer_size];
+    const int  image_x1 = data->mBitmap.x1;
+    const int  image_y1 = data->mBitmap.y1;
+    const int  image_x2 = data->mBitmap.x2 - 1;
+    const int  image_y2 = data->mBitmap.y2 - 1;
+    const int  fdx = (int)(data->m11 * fixed_scale);
+    const int  fdy = (int)(data->m12 * fixed_scale);
+    while (count--) {
+        uint *      target = data->buffer(spans->x, spans->y);
+        const float cx = spans->x + float(0.5);
+        const float cy = spans->y + float(0.5);
+        // taps are pixel centers, so sample half a pixel up left
+        int x = int((data->m21 * cy + data->m11 * cx + data->dx) * fixed_scale) -
+                fixed_scale / 2;
+        int y = int((data->m22 * cy + data->m12 * cx + data->dy) * fixed_scale) -
+                fixed_scale / 2;
+        int       length = spans->len;
+        const int coverage = (spans->coverage * data->mBitmap.const_alpha) >> 8;
+        while (length) {
+            int         l = std::min(length, buffer_size);
+            const uint *end = buffer + l;
+            uint *      b = buffer;
+            while (b < end) {
+                const int  x1 = clamp(x >> 16, image_x1, image_x2);
+                const int  x2 = clamp((x >> 16) + 1, image_x1, image_x2);
+                const int  y1 = clamp(y >> 16, image_y1, image_y2);
+                const int  y2 = clamp((y >> 16) + 1, image_y1, image_y2);
+                const uint distx = uint(x & 0xffff) >> 8;
+                const uint disty = uint(y & 0xffff) >> 8;
+                const uint *row1 = reinterpret_cast<const uint *>(data->mBitmap.scanLine(y1));
+                const uint *row2 = reinterpret_cast<const uint *>(data->mBitmap.scanLine(y2));
+                const uint top = interpolate_pixel(row1[x1], 256 - distx, row1[x2], distx);
+                const uint bottom = interpolate_pixel(row2[x1], 256 - distx, row2[x2], distx);
+                *b = interpolate_pixel(top, 256 - disty, bottom, disty);
+                x += fdx;
+                y += fdy;
+                ++b;
+            }
+            op.func(target, buffer, l, coverage);
+            target += l;
+            length -= l;
+        }
+        ++spans;
+    }
+}
+// axis aligned shrink by whole factors, every target pixel is the average
+// of its nx * ny source block. block rows are first summed per source
+// column, channels in 16 bit lanes B, G, R, A of one 64 bit word, then nx
+// column sums make a pixel. lanes hold up to 16 * 16 * 255.
+constexpr int max_box_size = 16;
+// target pixels per column pass, column sums fit on the stack
+constexpr int box_chunk = 64;
+static inline uint64_t box_spread(uint p) {
+    uint64_t v = p;
+    v = (v | (v << 16)) & 0x0000ffff0000ffffULL;
+    return (v | (v << 8)) & 0x00ff00ff00ff00ffULL;
+}
+#if !defined(IMLOTTIE_SSE2) && !defined(IMLOTTIE_NEON) || defined(IMLOTTIE_CONFORM)
+static void boxColumns_C(const uint *const *rows, int ny, int sx, int columns, uint64_t *cols) {
+    const uint *row = rows[0] + sx;
+    for (int k = 0; k < columns; k++) cols[k] = box_spread(row[k]);
+    for (int j = 1; j < ny; j++) {
+        row = rows[j] + sx;
+        for (int k = 0; k < columns; k++) cols[k] += box_spread(row[k]);
+    }
+}
+#endif
+#if defined(IMLOTTIE_SSE2)
+// widening bytes to 16 bits gives the lane order of box_spread
+static void boxColumns_SSE2(const uint *const *rows, int ny, int sx, int columns, uint64_t *cols) {
+    const __m128i zero = _mm_setzero_si128();
+    int           k = 0;
+    for (; k + 4 <= columns; k += 4) {
+        __m128i lo = zero, hi = zero;
+        for (int j = 0; j < ny; j++) {
+            const __m128i p = _mm_loadu_si128((const __m128i *)(rows[j] + sx + k));
+            lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(p, zero));
+            hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(p, zero));
+        }
+        _mm_storeu_si128((__m128i *)(cols + k), lo);
+        _mm_storeu_si128((__m128i *)(cols + k + 2), hi);
+    }
+    for (; k < columns; k++) {
+        uint64_t sum = 0;
+        for (int j = 0; j < ny; j++) sum += box_spread(rows[j][sx + k]);
+        cols[k] = sum;
+    }
+}
+#elif defined(IMLOTTIE_NEON)
+static void boxColumns_NEON(const uint *const *rows, int ny, int sx, int columns, uint64_t *cols) {
+    int k = 0;
+    for (; k + 4 <= columns; k += 4) {
+        uint16x8_t lo = vdupq_n_u16(0), hi = vdupq_n_u16(0);
+        for (int j = 0; j < ny; j++) {
+            const uint8x16_t p = vld1q_u8((const uint8_t *)(rows[j] + sx + k));
+            lo = vaddw_u8(lo, vget_low_u8(p));
+            hi = vaddw_u8(hi, vget_high_u8(p));
+        }
+        vst1q_u16((uint16_t *)(cols + k), lo);
+        vst1q_u16((uint16_t *)(cols + k + 2), hi);
+    }
+    for (; k < columns; k++) {
+        uint64_t sum = 0;
+        for (int j = 0; j < ny; j++) sum += box_spread(rows[j][sx + k]);
+        cols[k] = sum;
+    }
+}
+#endif
+static void boxColumns(const uint *const *rows, int ny, int sx, int columns, uint64_t *cols) {
+#if defined(IMLOTTIE_SSE2)
+    boxColumns_SSE2(rows, ny, sx, columns, cols);
+#elif defined(IMLOTTIE_NEON)
+    boxColumns_NEON(rows, ny, sx, columns, cols);
+#else
+    boxColumns_C(rows, ny, sx, columns, cols);
+#endif
+}
+// (sum * recip + 0x8000) >> 16 per lane, the rounded block average
+static inline uint box_average(uint64_t sum, uint recip) {
+    const uint bl = ((uint(sum) & 0xffff) * recip + 0x8000) >> 16;
+    const uint g = ((uint(sum >> 16) & 0xffff) * recip + 0x8000) >> 16;
+    const uint r = ((uint(sum >> 32) & 0xffff) * recip + 0x8000) >> 16;
+    const uint a = (uint(sum >> 48) * recip + 0x8000) >> 16;
+    return (a << 24) | (r << 16) | (g << 8) | bl;
+}
+// adds nx column sums per pixel, vector builds average two pixels at once
+// and give the same as box_average. NX is nx when known at compile time.
+template <int NX>
+static void boxAverage(const uint64_t *cols, int nx, int count, uint recip, uint *out) {
+    if (NX) nx = NX;
+    int i = 0;
+#if defined(IMLOTTIE_SSE2)
+    // recip fits 16 bits as blocks have two pixels at least. high half of
+    // the product plus the carry of the rounding add into the low half
+    const __m128i mul = _mm_set1_epi16(short(recip));
+    for (; i + 2 <= count; i += 2, cols += 2 * nx) {
+        __m128i sum = _mm_setzero_si128();
+        for (int k = 0; k < nx; k++) {
+            sum = _mm_add_epi16(sum, _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i *)(cols + k)),
+                                                        _mm_loadl_epi64((const __m128i *)(cols + nx + k))));
+        }
+        const __m128i avg = _mm_add_epi16(_mm_mulhi_epu16(sum, mul),
+                                          _mm_srli_epi16(_mm_mullo_epi16(sum, mul), 15));
+        _mm_storel_epi64((__m128i *)(out + i), _mm_packus_epi16(avg, avg));
+    }
+#elif defined(IMLOTTIE_NEON)
+    const uint16x4_t mul = vdup_n_u16(uint16_t(recip));
+    for (; i + 2 <= count; i += 2, cols += 2 * nx) {
+        uint16x8_t sum = vdupq_n_u16(0);
+        for (int k = 0; k < nx; k++) {
+            sum = vaddq_u16(sum, vcombine_u16(vld1_u16((const uint16_t *)(cols + k)),
+                                              vld1_u16((const uint16_t *)(cols + nx + k))));
+        }
+        const uint16x4_t lo = vrshrn_n_u32(vmull_u16(vget_low_u16(sum), mul), 16);
+        const uint16x4_t hi = vrshrn_n_u32(vmull_u16(vget_high_u16(sum), mul), 16);
+        vst1_u8((uint8_t *)(out + i), vmovn_u16(vcombine_u16(lo, hi)));
+    }
+#endif
+    for (; i < count; i++, cols += nx) {
+        uint64_t sum = cols[0];
+        for (int k = 1; k < nx; k++) sum += cols[k];
+        out[i] = box_average(sum, recip);
+    }
+}
+// NX is the block width when known at compile time, 0 reads it from the
+// matrix.
+template <int NX>
+static void blend_scaled_box_argb(size_t count, const VRle::Span *spans, void *userData) {
+    VSpanData *data = reinterpret_cast<VSpanData *>(userData);
+    Operator   op = getOperator(data, spans, count);
+    uint       buffer[buffer_size];
+    uint64_t   cols[box_chunk * max_box_size];
+    const int  image_x1 = data->mBitmap.x1;
+    const int  image_y1 = data->mBitmap.y1;
+    const int  image_x2 = data->mBitmap.x2 - 1;
+    const int  image_y2 = data->mBitmap.y2 - 1;
+    const int  nx = NX ? NX : int(data->m11 + float(0.5));
+    const int  ny = int(data->m22 + float(0.5));
+    const uint area = uint(nx * ny);
+    const uint recip = (65536 + area / 2) / area;
+    const uint *rows[max_box_size];
+    while (count--) {
+        uint *target = data->buffer(spans->x, spans->y);
+        const int sy = int(std::floor(data->m22 * spans->y + data->dy + float(0.5)));
+        for (int j = 0; j < ny; j++) {
+            rows[j] = reinterpret_cast<const uint *>(
+                data->mBitmap.scanLine(clamp(sy + j, image_y1, image_y2)));
+        }
+        int sx = int(std::floor(data->m11 * spans->x + data->dx + float(0.5)));
+        int       length = spans->len;
+        const int coverage = (spans->coverage * data->mBitmap.const_alpha) >> 8;
+        while (length) {
+            const int l = std::min(length, buffer_size);
+            for (int done = 0; done < l;) {
+                const int chunk = std::min(l - done, box_chunk);
+                const int columns = chunk * nx;
+                if (sx >= image_x1 && sx + columns - 1 <= image_x2) {
+                    boxColumns(rows, ny, sx, columns, cols);
+                } else {
+                    for (int k = 0; k < columns; k++) {
+                        const int x = clamp(sx + k, image_x1, image_x2);
+                        uint64_t  sum = 0;
+                        for (int j = 0; j < ny; j++) sum += box_spread(rows[j][x]);
+                        cols[k] = sum;
+                    }
+                }
+                boxAverage<NX>(cols, nx, chunk, recip, buffer + done);
+                sx += columns;
+                done += chunk;
+            }
+            op.func(target, buffer, l, coverage);
+            target += l;
+            length -= l;
+        }
+        ++spans;
+    }
+}
+// blocks of whole factor shrinks left after the mip level, see setupTextureFilter()
+static ProcessRleSpan boxBlendFunc(int nx) {
+    switch (nx) {
+    case 2: return &blend_scaled_box_argb<2>;
+    case 3: return &blend_scaled_box_argb<3>;
+    case 4: return &blend_scaled_box_argb<4>;
+    default: return &blend_scaled_box_argb<0>;
+    }
+}
+// smoothing of minified images, see configureImageSmoothing()
+static std::atomic<bool> &imageSmoothing() {
+    static std::atomic<bool> enabled{false};
+    return enabled;
+}
 void VSpanData::updateSpanFunc() {
     switch (mType) {
     case VSpanData::Type::None:
@@ -2410,7 +3574,11 @@ void VSpanData::updateSpanFunc() {
     }
     case VSpanData::Type::Texture: {
         //@TODO update proper image function.
-        if (transformType <= VMatrix::MatrixType::Translate) {
+        if (mTextureFilter == TextureFilter::Box) {
+            mUnclippedBlendFunc = boxBlendFunc(int(m11 + float(0.5)));
+        } else if (mTextureFilter == TextureFilter::Bilinear) {
+            mUnclippedBlendFunc = &blend_transformed_bilinear_argb;
+        } else if (transformType <= VMatrix::MatrixType::Translate) {
             mUnclippedBlendFunc = &blend_untransformed_argb;
         } else {
             mUnclippedBlendFunc = &blend_transformed_argb;
@@ -2470,6 +3638,7 @@ void VSpanData::setup(const VBrush &brush, BlendMode /*mode*/, int /*alpha*/) {
             &brush.mTexture->mBitmap, brush.mTexture->mAlpha, VBitmapData::Plain,
             brush.mTexture->mBitmap.rect());
         setupMatrix(brush.mTexture->mMatrix);
+        setupTextureFilter(&brush.mTexture->mBitmap);
         break;
     }
     default:
@@ -2509,8 +3678,85 @@ void VSpanData::initTexture(const VBitmap *bitmap, int alpha,
     mBitmap.y2 = std::min(mBitmap.y1 + sourceRect.height(), mBitmap.height);
     mBitmap.const_alpha = alpha;
     mBitmap.type = type;
+    mTextureFilter = TextureFilter::Nearest;
     updateSpanFunc();
 }
+// Picks the sampler from how many source pixels a target pixel spans:
+// nearest when drawn at size or bigger, power of two shrinks draw their mip
+// level as it is, which is faster than sampling the full image. With
+// smoothing other whole factor shrinks take the mip level of their power
+// of two part and box filter the rest, remaining shrinks go bilinear from
+// the mip level just above the target size.
+void VSpanData::setupTextureFilter(const VBitmap *image) {
+    mTextureFilter = TextureFilter::Nearest;
+    if (!fast_matrix || mBitmap.format != VBitmap::Format::ARGB32_Premultiplied)
+        return;
+    const bool smoothing = imageSmoothing();
+
+    auto useMipLevel = [this, image](uint level) {
+        if (!level) return;
+        VBitmap     mip = image->mipLevel(level);
+        const float factor = 1.0f / (1 << level);
+        const int   round = (1 << level) - 1;
+        mBitmap.imageData = mip.data();
+        mBitmap.width = int(mip.width());
+        mBitmap.height = int(mip.height());
+        mBitmap.bytesPerLine = static_cast<uint>(mip.stride());
+        mBitmap.x1 >>= level;
+        mBitmap.y1 >>= level;
+        mBitmap.x2 = std::min((mBitmap.x2 + round) >> level, mBitmap.width);
+        mBitmap.y2 = std::min((mBitmap.y2 + round) >> level, mBitmap.height);
+        m11 *= factor;
+        m12 *= factor;
+        m21 *= factor;
+        m22 *= factor;
+        dx *= factor;
+        dy *= factor;
+    };
+    // levels stop at a 1x1 image
+    auto maxLevel = [this](uint level) {
+        while (level && !((mBitmap.width | mBitmap.height) >> level)) level--;
+        return level;
+    };
+
+    if (transformType == VMatrix::MatrixType::Scale) {
+        const float nx = std::round(m11), ny = std::round(m22);
+        if (nx >= 1 && ny >= 1 && nx * ny >= 2 && std::fabs(m11 - nx) < 1.0f / 256 &&
+            std::fabs(m22 - ny) < 1.0f / 256) {
+            uint boxX = uint(nx), boxY = uint(ny), level = 0;
+            while (!((boxX | boxY) & 1) && level < maxLevel(level + 1)) {
+                boxX >>= 1;
+                boxY >>= 1;
+                level++;
+            }
+            if (boxX * boxY == 1) {
+                // exact power of two, the mip level is drawn as it is
+                useMipLevel(level);
+                transformType = VMatrix::MatrixType::Translate;
+                return;
+            }
+            if (smoothing && boxX <= max_box_size && boxY <= max_box_size) {
+                useMipLevel(level);
+                mTextureFilter = TextureFilter::Box;
+                return;
+            }
+        }
+    }
+    if (!smoothing) return;
+
+    const float scaleX = std::sqrt(m11 * m11 + m12 * m12);
+    const float scaleY = std::sqrt(m21 * m21 + m22 * m22);
+    float       shrink = std::min(scaleX, scaleY);
+    if (shrink < 1 + 1.0f / 256) return;
+
+    uint level = 0;
+    while (shrink >= 2 && level < maxLevel(level + 1)) {
+        shrink /= 2;
+        level++;
+    }
+    useMipLevel(level);
+    mTextureFilter = TextureFilter::Bilinear;
+}
 bool VGradientCache::generateGradientColorTable(const VGradientStops &stops,
                                                 float                 opacity,
                                                 uint32_t *colorTable, int size) {
@@ -2593,9 +3839,61 @@ void VDrawable::applyDashOp()
     }
 }
 
+// 26.6 fixed point position the rasterizer sees, truncated the same way as
+// FTOutline::TO_FT_COORD
+static inline VPoint vRasterPoint(const VPointF &point)
+{
+    return VPoint(int(point.x() * 64), int(point.y() * 64));
+}
+
+// Path that moved by whole pixels since it was last rasterized gets the
+// previous rle shifted instead. Every point must land exactly 64 * offset
+// away in 26.6 units from the rasterized one, anything finer would change
+// edge coverage.
+bool VDrawable::translateRle(const VRect &clip)
+{
+    if (!mRleReusable || clip != mRleClip || mFillRule != mRleFillRule) return false;
+
+    const auto &points = mPath.points();
+    if (points.empty() || points.size() != mRlePoints.size() ||
+        mPath.elements() != mRleElements)
+        return false;
+
+    const VPoint offset = vRasterPoint(points[0]) - mRlePoints[0];
+    if (offset.x() % 64 || offset.y() % 64) return false;
+    for (size_t i = 1; i < points.size(); i++) {
+        if (vRasterPoint(points[i]) - mRlePoints[i] != offset) return false;
+    }
+    const int dx = offset.x() / 64, dy = offset.y() / 64;
+    if (!dx && !dy) return true;
+
+    // spans cut by the clip would stay cut after the move
+    const VRect bbox = mRasterizer.rle().boundingRect();
+    const VRect moved = bbox.translated(dx, dy);
+    if (!bbox.empty() && (!clip.contains(bbox, true) || !clip.contains(moved, true)))
+        return false;
+
+    mRasterizer.translate(VPoint(dx, dy));
+    for (auto &point : mRlePoints) point += offset;
+    LOTTIE_TRACE_COUNT(rleTranslated, 1);
+    return true;
+}
+
 void VDrawable::preprocess(const VRect &clip)
 {
     if (mFlag & (DirtyState::Path)) {
+        if (translateRle(clip)) {
+            mPath = {};
+            mFlag &= ~DirtyFlag(DirtyState::Path);
+            return;
+        }
+        mRleElements = mPath.elements();
+        mRlePoints.clear();
+        for (const auto &point : mPath.points()) mRlePoints.push_back(vRasterPoint(point));
+        mRleClip = clip;
+        mRleFillRule = mFillRule;
+        // dash segments are split in float, they do not move exactly
+        mRleReusable = mType != Type::StrokeWithDash;
         if (mType == Type::Fill) {
             mRasterizer.rasterize(std::move(mPath), mFillRule, clip);
         } else {
@@ -2627,6 +3925,7 @@ void VDrawable::setStrokeInfo(CapStyle cap, JoinStyle join, float miterLimit,
     mStrokeInfo->miterLimit = miterLimit;
     mStrokeInfo->width = strokeWidth;
     mFlag |= DirtyState::Path;
+    mRleReusable = false;
 }
 
 void VDrawable::setDashInfo(std::vector<float> &dashInfo)
@@ -2653,6 +3952,7 @@ void VDrawable::setDashInfo(std::vector<float> &dashInfo)
     obj->mDash = dashInfo;
 
     mFlag |= DirtyState::Path;
+    mRleReusable = false;
 }
 
 void VDrawable::setPath(const VPath &path)
@@ -2801,7 +4101,584 @@ static void comp_func_DestinationOut(uint *dest, const uint *src, int length, ui
 CompositionFunctionSolid COMP_functionForModeSolid_C[] = { comp_func_solid_Source, comp_func_solid_SourceOver, comp_func_solid_DestinationIn, comp_func_solid_DestinationOut};
 CompositionFunction COMP_functionForMode_C[] = { comp_func_Source, comp_func_SourceOver, comp_func_DestinationIn, comp_func_DestinationOut};
 
-void vInitBlendFunctions() {}
+#if defined(IMLOTTIE_SSE2)
+// All SSE2 kernels work on 4 pixels per step and hand the tail to the
+// scalar kernel. Channels are widened to 16 bit so (c * a) >> 8 matches
+// BYTE_MUL bit for bit, and the final add stays a 32 bit add like the
+// scalar code.
+static inline __m128i v_byte_mul_sse2(__m128i c, __m128i alo, __m128i ahi)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(c, zero), alo);
+    __m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(c, zero), ahi);
+    return _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8));
+}
+
+static inline __m128i v_byte_mul_sse2(__m128i c, __m128i alpha32)
+{
+    // spread each pixel alpha over its four 16 bit channels
+    __m128i a = _mm_or_si128(alpha32, _mm_slli_epi32(alpha32, 16));
+    return v_byte_mul_sse2(c, _mm_unpacklo_epi32(a, a), _mm_unpackhi_epi32(a, a));
+}
+
+static inline __m128i v_alpha_sse2(__m128i c)
+{
+    return _mm_srli_epi32(c, 24);
+}
+
+static inline __m128i v_ialpha_sse2(__m128i c)
+{
+    return _mm_srli_epi32(_mm_xor_si128(c, _mm_set1_epi32(-1)), 24);
+}
+
+static void comp_func_solid_Source_SSE2(uint32_t *dest, int length, uint32_t color,
+                                        uint32_t const_alpha)
+{
+    if (const_alpha == 255) {
+        memfill32(dest, color, length);
+        return;
+    }
+    uint32_t c = BYTE_MUL(color, const_alpha);
+    __m128i  vc = _mm_set1_epi32(int(c));
+    __m128i  ia = _mm_set1_epi16(short(255 - const_alpha));
+    int      i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+        _mm_storeu_si128((__m128i *)(dest + i), _mm_add_epi32(vc, v_byte_mul_sse2(d, ia, ia)));
+    }
+    if (i < length) comp_func_solid_Source(dest + i, length - i, color, const_alpha);
+}
+
+static void comp_func_solid_SourceOver_SSE2(uint32_t *dest, int length, uint32_t color,
+                                            uint32_t const_alpha)
+{
+    if (const_alpha != 255) color = BYTE_MUL(color, const_alpha);
+    __m128i vc = _mm_set1_epi32(int(color));
+    __m128i ia = _mm_set1_epi16(short(255 - vAlpha(color)));
+    int     i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+        _mm_storeu_si128((__m128i *)(dest + i), _mm_add_epi32(vc, v_byte_mul_sse2(d, ia, ia)));
+    }
+    if (i < length) comp_func_solid_SourceOver(dest + i, length - i, color, 255);
+}
+
+static void comp_func_solid_DestinationIn_SSE2(uint *dest, int length, uint color,
+                                               uint const_alpha)
+{
+    uint a = vAlpha(color);
+    if (const_alpha != 255) a = BYTE_MUL(a, const_alpha) + 255 - const_alpha;
+    __m128i va = _mm_set1_epi16(short(a));
+    int     i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+        _mm_storeu_si128((__m128i *)(dest + i), v_byte_mul_sse2(d, va, va));
+    }
+    if (i < length) comp_func_solid_DestinationIn(dest + i, length - i, color, const_alpha);
+}
+
+static void comp_func_solid_DestinationOut_SSE2(uint *dest, int length, uint color,
+                                                uint const_alpha)
+{
+    uint a = vAlpha(~color);
+    if (const_alpha != 255) a = BYTE_MUL(a, const_alpha) + 255 - const_alpha;
+    __m128i va = _mm_set1_epi16(short(a));
+    int     i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+        _mm_storeu_si128((__m128i *)(dest + i), v_byte_mul_sse2(d, va, va));
+    }
+    if (i < length) comp_func_solid_DestinationOut(dest + i, length - i, color, const_alpha);
+}
+
+static void comp_func_Source_SSE2(uint32_t *dest, const uint32_t *src, int length,
+                                  uint32_t const_alpha)
+{
+    if (const_alpha == 255) {
+        memcpy(dest, src, size_t(length) * sizeof(uint));
+        return;
+    }
+    const __m128i zero = _mm_setzero_si128();
+    __m128i       ca = _mm_set1_epi16(short(const_alpha));
+    __m128i       cia = _mm_set1_epi16(short(255 - const_alpha));
+    int           i = 0;
+    for (; i + 4 <= length; i += 4) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(s, zero), ca),
+                                   _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), cia));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(s, zero), ca),
+                                   _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), cia));
+        _mm_storeu_si128((__m128i *)(dest + i),
+                         _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+    }
+    if (i < length) comp_func_Source(dest + i, src + i, length - i, const_alpha);
+}
+
+static void comp_func_SourceOver_SSE2(uint32_t *dest, const uint32_t *src, int length,
+                                      uint32_t const_alpha)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int           i = 0;
+    if (const_alpha == 255) {
+        for (; i + 4 <= length; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+            __m128i r = _mm_add_epi32(s, v_byte_mul_sse2(d, v_ialpha_sse2(s)));
+            // fully transparent source leaves dest untouched
+            __m128i empty = _mm_cmpeq_epi32(s, zero);
+            r = _mm_or_si128(_mm_and_si128(empty, d), _mm_andnot_si128(empty, r));
+            _mm_storeu_si128((__m128i *)(dest + i), r);
+        }
+    } else {
+        __m128i ca = _mm_set1_epi16(short(const_alpha));
+        for (; i + 4 <= length; i += 4) {
+            __m128i s = v_byte_mul_sse2(_mm_loadu_si128((const __m128i *)(src + i)), ca, ca);
+            __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+            _mm_storeu_si128((__m128i *)(dest + i),
+                             _mm_add_epi32(s, v_byte_mul_sse2(d, v_ialpha_sse2(s))));
+        }
+    }
+    if (i < length) comp_func_SourceOver(dest + i, src + i, length - i, const_alpha);
+}
+
+static void comp_func_DestinationIn_SSE2(uint *dest, const uint *src, int length,
+                                         uint const_alpha)
+{
+    int i = 0;
+    if (const_alpha == 255) {
+        for (; i + 4 <= length; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+            _mm_storeu_si128((__m128i *)(dest + i), v_byte_mul_sse2(d, v_alpha_sse2(s)));
+        }
+    } else {
+        __m128i ca = _mm_set1_epi32(int(const_alpha));
+        __m128i cia = _mm_set1_epi32(int(255 - const_alpha));
+        for (; i + 4 <= length; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+            __m128i a = _mm_add_epi32(
+                _mm_srli_epi32(_mm_mullo_epi16(v_alpha_sse2(s), ca), 8), cia);
+            _mm_storeu_si128((__m128i *)(dest + i), v_byte_mul_sse2(d, a));
+        }
+    }
+    if (i < length) comp_func_DestinationIn(dest + i, src + i, length - i, const_alpha);
+}
+
+static void comp_func_DestinationOut_SSE2(uint *dest, const uint *src, int length,
+                                          uint const_alpha)
+{
+    int i = 0;
+    if (const_alpha == 255) {
+        for (; i + 4 <= length; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+            _mm_storeu_si128((__m128i *)(dest + i), v_byte_mul_sse2(d, v_ialpha_sse2(s)));
+        }
+    } else {
+        __m128i ca = _mm_set1_epi32(int(const_alpha));
+        __m128i cia = _mm_set1_epi32(int(255 - const_alpha));
+        for (; i + 4 <= length; i += 4) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+            __m128i d = _mm_loadu_si128((const __m128i *)(dest + i));
+            __m128i a = _mm_add_epi32(
+                _mm_srli_epi32(_mm_mullo_epi16(v_ialpha_sse2(s), ca), 8), cia);
+            _mm_storeu_si128((__m128i *)(dest + i), v_byte_mul_sse2(d, a));
+        }
+    }
+    if (i < length) comp_func_DestinationOut(dest + i, src + i, length - i, const_alpha);
+}
+
+CompositionFunctionSolid COMP_functionForModeSolid_SSE2[] = { comp_func_solid_Source_SSE2, comp_func_solid_SourceOver_SSE2, comp_func_solid_DestinationIn_SSE2, comp_func_solid_DestinationOut_SSE2};
+CompositionFunction COMP_functionForMode_SSE2[] = { comp_func_Source_SSE2, comp_func_SourceOver_SSE2, comp_func_DestinationIn_SSE2, comp_func_DestinationOut_SSE2};
+#endif // IMLOTTIE_SSE2
+
+#if defined(IMLOTTIE_NEON)
+// NEON kernels, 4 pixels per step with the tail handed to the scalar
+// kernel. vmull_u8 + vshrn_n_u16(.., 8) is exactly BYTE_MUL per channel.
+static inline uint32x4_t v_byte_mul_neon(uint32x4_t c, uint8x8_t alo, uint8x8_t ahi)
+{
+    uint8x16_t c8 = vreinterpretq_u8_u32(c);
+    uint8x8_t  lo = vshrn_n_u16(vmull_u8(vget_low_u8(c8), alo), 8);
+    uint8x8_t  hi = vshrn_n_u16(vmull_u8(vget_high_u8(c8), ahi), 8);
+    return vreinterpretq_u32_u8(vcombine_u8(lo, hi));
+}
+
+// alpha byte of two pixels spread over their channels (low, high half)
+static inline void v_alpha_neon(uint32x4_t c, uint8x8_t &lo, uint8x8_t &hi)
+{
+    static const uint8_t kAlphaIndex[8] = {3, 3, 3, 3, 7, 7, 7, 7};
+    uint8x8_t  index = vld1_u8(kAlphaIndex);
+    uint8x16_t c8 = vreinterpretq_u8_u32(c);
+    lo = vtbl1_u8(vget_low_u8(c8), index);
+    hi = vtbl1_u8(vget_high_u8(c8), index);
+}
+
+static void comp_func_solid_Source_NEON(uint32_t *dest, int length, uint32_t color,
+                                        uint32_t const_alpha)
+{
+    if (const_alpha == 255) {
+        memfill32(dest, color, length);
+        return;
+    }
+    uint32_t   c = BYTE_MUL(color, const_alpha);
+    uint32x4_t vc = vdupq_n_u32(c);
+    uint8x8_t  ia = vdup_n_u8(uint8_t(255 - const_alpha));
+    int        i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint32x4_t d = vld1q_u32(dest + i);
+        vst1q_u32(dest + i, vaddq_u32(vc, v_byte_mul_neon(d, ia, ia)));
+    }
+    if (i < length) comp_func_solid_Source(dest + i, length - i, color, const_alpha);
+}
+
+static void comp_func_solid_SourceOver_NEON(uint32_t *dest, int length, uint32_t color,
+                                            uint32_t const_alpha)
+{
+    if (const_alpha != 255) color = BYTE_MUL(color, const_alpha);
+    uint32x4_t vc = vdupq_n_u32(color);
+    uint8x8_t  ia = vdup_n_u8(uint8_t(255 - vAlpha(color)));
+    int        i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint32x4_t d = vld1q_u32(dest + i);
+        vst1q_u32(dest + i, vaddq_u32(vc, v_byte_mul_neon(d, ia, ia)));
+    }
+    if (i < length) comp_func_solid_SourceOver(dest + i, length - i, color, 255);
+}
+
+static void comp_func_solid_DestinationIn_NEON(uint *dest, int length, uint color,
+                                               uint const_alpha)
+{
+    uint a = vAlpha(color);
+    if (const_alpha != 255) a = BYTE_MUL(a, const_alpha) + 255 - const_alpha;
+    uint8x8_t va = vdup_n_u8(uint8_t(a));
+    int       i = 0;
+    for (; i + 4 <= length; i += 4)
+        vst1q_u32(dest + i, v_byte_mul_neon(vld1q_u32(dest + i), va, va));
+    if (i < length) comp_func_solid_DestinationIn(dest + i, length - i, color, const_alpha);
+}
+
+static void comp_func_solid_DestinationOut_NEON(uint *dest, int length, uint color,
+                                                uint const_alpha)
+{
+    uint a = vAlpha(~color);
+    if (const_alpha != 255) a = BYTE_MUL(a, const_alpha) + 255 - const_alpha;
+    uint8x8_t va = vdup_n_u8(uint8_t(a));
+    int       i = 0;
+    for (; i + 4 <= length; i += 4)
+        vst1q_u32(dest + i, v_byte_mul_neon(vld1q_u32(dest + i), va, va));
+    if (i < length) comp_func_solid_DestinationOut(dest + i, length - i, color, const_alpha);
+}
+
+static void comp_func_Source_NEON(uint32_t *dest, const uint32_t *src, int length,
+                                  uint32_t const_alpha)
+{
+    if (const_alpha == 255) {
+        memcpy(dest, src, size_t(length) * sizeof(uint));
+        return;
+    }
+    uint8x8_t ca = vdup_n_u8(uint8_t(const_alpha));
+    uint8x8_t cia = vdup_n_u8(uint8_t(255 - const_alpha));
+    int       i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint8x16_t s = vreinterpretq_u8_u32(vld1q_u32(src + i));
+        uint8x16_t d = vreinterpretq_u8_u32(vld1q_u32(dest + i));
+        uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(s), ca), vget_low_u8(d), cia);
+        uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(s), ca), vget_high_u8(d), cia);
+        vst1q_u32(dest + i, vreinterpretq_u32_u8(vcombine_u8(vshrn_n_u16(lo, 8),
+                                                             vshrn_n_u16(hi, 8))));
+    }
+    if (i < length) comp_func_Source(dest + i, src + i, length - i, const_alpha);
+}
+
+static void comp_func_SourceOver_NEON(uint32_t *dest, const uint32_t *src, int length,
+                                      uint32_t const_alpha)
+{
+    int i = 0;
+    if (const_alpha == 255) {
+        for (; i + 4 <= length; i += 4) {
+            uint32x4_t s = vld1q_u32(src + i);
+            uint32x4_t d = vld1q_u32(dest + i);
+            uint8x8_t  lo, hi;
+            v_alpha_neon(s, lo, hi);
+            uint32x4_t r = vaddq_u32(s, v_byte_mul_neon(d, vmvn_u8(lo), vmvn_u8(hi)));
+            // fully transparent source leaves dest untouched
+            uint32x4_t empty = vceqq_u32(s, vdupq_n_u32(0));
+            vst1q_u32(dest + i, vbslq_u32(empty, d, r));
+        }
+    } else {
+        uint8x8_t ca = vdup_n_u8(uint8_t(const_alpha));
+        for (; i + 4 <= length; i += 4) {
+            uint32x4_t s = v_byte_mul_neon(vld1q_u32(src + i), ca, ca);
+            uint32x4_t d = vld1q_u32(dest + i);
+            uint8x8_t  lo, hi;
+            v_alpha_neon(s, lo, hi);
+            vst1q_u32(dest + i, vaddq_u32(s, v_byte_mul_neon(d, vmvn_u8(lo), vmvn_u8(hi))));
+        }
+    }
+    if (i < length) comp_func_SourceOver(dest + i, src + i, length - i, const_alpha);
+}
+
+static void comp_func_DestinationIn_NEON(uint *dest, const uint *src, int length,
+                                         uint const_alpha)
+{
+    uint8x8_t ca = vdup_n_u8(uint8_t(const_alpha));
+    uint8x8_t cia = vdup_n_u8(uint8_t(255 - const_alpha));
+    int       i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint8x8_t lo, hi;
+        v_alpha_neon(vld1q_u32(src + i), lo, hi);
+        if (const_alpha != 255) {
+            lo = vadd_u8(vshrn_n_u16(vmull_u8(lo, ca), 8), cia);
+            hi = vadd_u8(vshrn_n_u16(vmull_u8(hi, ca), 8), cia);
+        }
+        vst1q_u32(dest + i, v_byte_mul_neon(vld1q_u32(dest + i), lo, hi));
+    }
+    if (i < length) comp_func_DestinationIn(dest + i, src + i, length - i, const_alpha);
+}
+
+static void comp_func_DestinationOut_NEON(uint *dest, const uint *src, int length,
+                                          uint const_alpha)
+{
+    uint8x8_t ca = vdup_n_u8(uint8_t(const_alpha));
+    uint8x8_t cia = vdup_n_u8(uint8_t(255 - const_alpha));
+    int       i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint8x8_t lo, hi;
+        v_alpha_neon(vld1q_u32(src + i), lo, hi);
+        lo = vmvn_u8(lo);
+        hi = vmvn_u8(hi);
+        if (const_alpha != 255) {
+            lo = vadd_u8(vshrn_n_u16(vmull_u8(lo, ca), 8), cia);
+            hi = vadd_u8(vshrn_n_u16(vmull_u8(hi, ca), 8), cia);
+        }
+        vst1q_u32(dest + i, v_byte_mul_neon(vld1q_u32(dest + i), lo, hi));
+    }
+    if (i < length) comp_func_DestinationOut(dest + i, src + i, length - i, const_alpha);
+}
+
+CompositionFunctionSolid COMP_functionForModeSolid_NEON[] = { comp_func_solid_Source_NEON, comp_func_solid_SourceOver_NEON, comp_func_solid_DestinationIn_NEON, comp_func_solid_DestinationOut_NEON};
+CompositionFunction COMP_functionForMode_NEON[] = { comp_func_Source_NEON, comp_func_SourceOver_NEON, comp_func_DestinationIn_NEON, comp_func_DestinationOut_NEON};
+#endif // IMLOTTIE_NEON
+
+// Pixel format conversions over whole buffers: luma mattes of offscreen
+// layers and decoded images. The scalar versions are the reference.
+
+// straight channel = c * 255 / a truncated, as (c * table[a]) >> 16. the
+// entry is 255 * 2^16 / a rounded up, exact for every c, a <= 255 and the
+// product stays in 32 bits. scalar kernels divide instead.
+#if defined(IMLOTTIE_SSE2) || defined(IMLOTTIE_NEON) || defined(IMLOTTIE_CONFORM)
+static const uint32_t *vUnpremultiplyTable()
+{
+    static const struct Table {
+        uint32_t value[256];
+        Table()
+        {
+            value[0] = 0;
+            for (uint32_t a = 1; a < 256; a++) value[a] = (255 * 65536 + a - 1) / a;
+        }
+    } TABLE;
+    return TABLE.value;
+}
+#endif
+
+static void vLumaMatte_C(uint32_t *pixels, int length)
+{
+    for (int i = 0; i < length; i++) {
+        int alpha = vAlpha(pixels[i]);
+        if (alpha == 0) continue;
+
+        int red = vRed(pixels[i]);
+        int green = vGreen(pixels[i]);
+        int blue = vBlue(pixels[i]);
+
+        if (alpha != 255) {
+            // un multiply
+            red = (red * 255) / alpha;
+            green = (green * 255) / alpha;
+            blue = (blue * 255) / alpha;
+        }
+        int luminosity = int(0.299f * red + 0.587f * green + 0.114f * blue);
+        pixels[i] = uint32_t(luminosity) << 24;
+    }
+}
+
+// stb_image RGBA bytes to premultiplied ARGB32 (BGRA bytes), channel * a / 255 truncated
+static void vPremultiplyRGBA_C(uint32_t *pixels, int length)
+{
+    uchar *pix = reinterpret_cast<uchar *>(pixels);
+    for (int i = 0; i < length; i++, pix += 4) {
+        uchar r = pix[0];
+        uchar g = pix[1];
+        uchar b = pix[2];
+        uchar a = pix[3];
+
+        pix[0] = uchar((b * a) / 255);
+        pix[1] = uchar((g * a) / 255);
+        pix[2] = uchar((r * a) / 255);
+    }
+}
+
+#if defined(IMLOTTIE_SSE2)
+// (c * m) >> 16 of unsigned 32 bit lanes, results below 2^16. SSE2 only
+// multiplies the even lanes, odd ones are shifted down for a second pass.
+static inline __m128i v_unpremultiply_sse2(__m128i c, __m128i m)
+{
+    const __m128i even = _mm_srli_epi64(_mm_mul_epu32(c, m), 16);
+    const __m128i odd = _mm_srli_epi64(
+        _mm_mul_epu32(_mm_srli_epi64(c, 32), _mm_srli_epi64(m, 32)), 16);
+    return _mm_or_si128(_mm_and_si128(even, _mm_set_epi32(0, -1, 0, -1)),
+                        _mm_slli_epi64(odd, 32));
+}
+
+// weights stay float and are applied in the scalar order, so the result
+// is bit exact with vLumaMatte_C
+static void vLumaMatte_SSE2(uint32_t *pixels, int length)
+{
+    const uint32_t *recip = vUnpremultiplyTable();
+    const __m128i   mask = _mm_set1_epi32(0xff);
+    const __m128    wr = _mm_set1_ps(0.299f);
+    const __m128    wg = _mm_set1_ps(0.587f);
+    const __m128    wb = _mm_set1_ps(0.114f);
+    int             i = 0;
+    for (; i + 4 <= length; i += 4) {
+        const __m128i p = _mm_loadu_si128((const __m128i *)(pixels + i));
+        const __m128i m = _mm_setr_epi32(int(recip[pixels[i] >> 24]), int(recip[pixels[i + 1] >> 24]),
+                                         int(recip[pixels[i + 2] >> 24]), int(recip[pixels[i + 3] >> 24]));
+        const __m128i r = v_unpremultiply_sse2(_mm_and_si128(_mm_srli_epi32(p, 16), mask), m);
+        const __m128i g = v_unpremultiply_sse2(_mm_and_si128(_mm_srli_epi32(p, 8), mask), m);
+        const __m128i b = v_unpremultiply_sse2(_mm_and_si128(p, mask), m);
+        const __m128  l = _mm_add_ps(_mm_add_ps(_mm_mul_ps(wr, _mm_cvtepi32_ps(r)),
+                                                _mm_mul_ps(wg, _mm_cvtepi32_ps(g))),
+                                     _mm_mul_ps(wb, _mm_cvtepi32_ps(b)));
+        // transparent pixels are left as they are
+        const __m128i keep = _mm_cmpeq_epi32(_mm_srli_epi32(p, 24), _mm_setzero_si128());
+        const __m128i luma = _mm_slli_epi32(_mm_cvttps_epi32(l), 24);
+        _mm_storeu_si128((__m128i *)(pixels + i),
+                         _mm_or_si128(_mm_and_si128(keep, p), _mm_andnot_si128(keep, luma)));
+    }
+    if (i < length) vLumaMatte_C(pixels + i, length - i);
+}
+
+// two pixels per 16 bit register, n / 255 == (n + 1 + (n >> 8)) >> 8 for n <= 255 * 255
+static inline __m128i v_premultiply_rgba_sse2(__m128i c)
+{
+    const __m128i a = _mm_shufflehi_epi16(_mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3)),
+                                          _MM_SHUFFLE(3, 3, 3, 3));
+    const __m128i alphaLanes = _mm_set_epi16(-1, 0, 0, 0, -1, 0, 0, 0);
+    __m128i       n = _mm_mullo_epi16(c, a);
+    n = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(n, _mm_set1_epi16(1)), _mm_srli_epi16(n, 8)), 8);
+    n = _mm_or_si128(_mm_andnot_si128(alphaLanes, n), _mm_and_si128(alphaLanes, c));
+    // r g b a -> b g r a
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(n, _MM_SHUFFLE(3, 0, 1, 2)),
+                               _MM_SHUFFLE(3, 0, 1, 2));
+}
+
+static void vPremultiplyRGBA_SSE2(uint32_t *pixels, int length)
+{
+    const __m128i zero = _mm_setzero_si128();
+    int           i = 0;
+    for (; i + 4 <= length; i += 4) {
+        const __m128i p = _mm_loadu_si128((const __m128i *)(pixels + i));
+        const __m128i lo = v_premultiply_rgba_sse2(_mm_unpacklo_epi8(p, zero));
+        const __m128i hi = v_premultiply_rgba_sse2(_mm_unpackhi_epi8(p, zero));
+        _mm_storeu_si128((__m128i *)(pixels + i), _mm_packus_epi16(lo, hi));
+    }
+    if (i < length) vPremultiplyRGBA_C(pixels + i, length - i);
+}
+#elif defined(IMLOTTIE_NEON)
+// see vLumaMatte_SSE2, the compiler may fuse the weights into multiply-add
+// on some targets so a luma sitting on a whole value can move by one.
+static void vLumaMatte_NEON(uint32_t *pixels, int length)
+{
+    const uint32_t *  recip = vUnpremultiplyTable();
+    const uint32x4_t  mask = vdupq_n_u32(0xff);
+    const float32x4_t wr = vdupq_n_f32(0.299f);
+    const float32x4_t wg = vdupq_n_f32(0.587f);
+    const float32x4_t wb = vdupq_n_f32(0.114f);
+    int               i = 0;
+    for (; i + 4 <= length; i += 4) {
+        const uint32x4_t p = vld1q_u32(pixels + i);
+        const uint32_t   factors[4] = {recip[pixels[i] >> 24], recip[pixels[i + 1] >> 24],
+                                     recip[pixels[i + 2] >> 24], recip[pixels[i + 3] >> 24]};
+        const uint32x4_t m = vld1q_u32(factors);
+        const uint32x4_t r = vshrq_n_u32(vmulq_u32(vandq_u32(vshrq_n_u32(p, 16), mask), m), 16);
+        const uint32x4_t g = vshrq_n_u32(vmulq_u32(vandq_u32(vshrq_n_u32(p, 8), mask), m), 16);
+        const uint32x4_t b = vshrq_n_u32(vmulq_u32(vandq_u32(p, mask), m), 16);
+        const float32x4_t l = vaddq_f32(vaddq_f32(vmulq_f32(wr, vcvtq_f32_u32(r)),
+                                                  vmulq_f32(wg, vcvtq_f32_u32(g))),
+                                        vmulq_f32(wb, vcvtq_f32_u32(b)));
+        const uint32x4_t keep = vceqq_u32(vshrq_n_u32(p, 24), vdupq_n_u32(0));
+        vst1q_u32(pixels + i, vbslq_u32(keep, p, vshlq_n_u32(vcvtq_u32_f32(l), 24)));
+    }
+    if (i < length) vLumaMatte_C(pixels + i, length - i);
+}
+
+// 8 pixels per step, vld4 splits the channels
+static inline uint8x8_t v_premultiply_neon(uint8x8_t c, uint8x8_t a)
+{
+    uint16x8_t n = vmull_u8(c, a);
+    n = vaddq_u16(vaddq_u16(n, vdupq_n_u16(1)), vshrq_n_u16(n, 8));
+    return vshrn_n_u16(n, 8);
+}
+
+static void vPremultiplyRGBA_NEON(uint32_t *pixels, int length)
+{
+    uchar *pix = reinterpret_cast<uchar *>(pixels);
+    int    i = 0;
+    for (; i + 8 <= length; i += 8, pix += 32) {
+        const uint8x8x4_t rgba = vld4_u8(pix);
+        uint8x8x4_t       bgra;
+        bgra.val[0] = v_premultiply_neon(rgba.val[2], rgba.val[3]);
+        bgra.val[1] = v_premultiply_neon(rgba.val[1], rgba.val[3]);
+        bgra.val[2] = v_premultiply_neon(rgba.val[0], rgba.val[3]);
+        bgra.val[3] = rgba.val[3];
+        vst4_u8(pix, bgra);
+    }
+    if (i < length) vPremultiplyRGBA_C(pixels + i, length - i);
+}
+#endif
+
+static void vLumaMatte(uint32_t *pixels, int length)
+{
+#if defined(IMLOTTIE_SSE2)
+    vLumaMatte_SSE2(pixels, length);
+#elif defined(IMLOTTIE_NEON)
+    vLumaMatte_NEON(pixels, length);
+#else
+    vLumaMatte_C(pixels, length);
+#endif
+}
+
+void vPremultiplyRGBA(uint32_t *pixels, size_t count)
+{
+    // rows of huge images are fine, a count over int range is split
+    while (count) {
+        const int length = int(std::min<size_t>(count, INT_MAX));
+#if defined(IMLOTTIE_SSE2)
+        vPremultiplyRGBA_SSE2(pixels, length);
+#elif defined(IMLOTTIE_NEON)
+        vPremultiplyRGBA_NEON(pixels, length);
+#else
+        vPremultiplyRGBA_C(pixels, length);
+#endif
+        pixels += length;
+        count -= size_t(length);
+    }
+}
+
+
+void vInitBlendFunctions()
+{
+#if defined(IMLOTTIE_SSE2)
+    functionForMode = COMP_functionForMode_SSE2;
+    functionForModeSolid = COMP_functionForModeSolid_SSE2;
+#elif defined(IMLOTTIE_NEON)
+    functionForMode = COMP_functionForMode_NEON;
+    functionForModeSolid = COMP_functionForModeSolid_NEON;
+#endif
+}
 
 void VBitmap::Impl::reset(size_t width, size_t height, VBitmap::Format format)
 {
@@ -2809,11 +4686,19 @@ void VBitmap::Impl::reset(size_t width, size_t height, VBitmap::Format format)
     mWidth = uint(width);
     mHeight = uint(height);
     mFormat = format;
+    mMips.clear();
 
     mDepth = depth(format);
     mStride = ((mWidth * mDepth + 31) >> 5)
         << 2;  // bytes per scanline (must be multiple of 4)
-    mOwnData = std::make_unique<uchar[]>(mStride * mHeight);
+    // keep the old allocation when it is big enough, offscreen layer
+    // buffers change size from frame to frame.
+    size_t needed = size_t(mStride) * mHeight;
+    if (!mOwnData || mCapacity < needed) {
+        LOTTIE_TRACE_COUNT(bytesAllocated, needed);
+        mOwnData = std::make_unique<uchar[]>(needed);
+        mCapacity = needed;
+    }
 }
 
 void VBitmap::Impl::reset(uchar *data, size_t width, size_t height, size_t bytesPerLine,
@@ -2824,8 +4709,10 @@ void VBitmap::Impl::reset(uchar *data, size_t width, size_t height, size_t bytes
     mHeight = uint(height);
     mStride = uint(bytesPerLine);
     mFormat = format;
+    mMips.clear();
     mDepth = depth(format);
     mOwnData = nullptr;
+    mCapacity = 0;
 }
 
 uchar VBitmap::Impl::depth(VBitmap::Format format)
@@ -2854,29 +4741,8 @@ void VBitmap::Impl::updateLuma()
 {
     if (mFormat != VBitmap::Format::ARGB32_Premultiplied) return;
     auto dataPtr = data();
-    for (uint col = 0; col < mHeight; col++) {
-        uint *pixel = (uint *)(dataPtr + mStride * col);
-        for (uint row = 0; row < mWidth; row++) {
-            int alpha = vAlpha(*pixel);
-            if (alpha == 0) {
-                pixel++;
-                continue;
-            }
-
-            int red = vRed(*pixel);
-            int green = vGreen(*pixel);
-            int blue = vBlue(*pixel);
-
-            if (alpha != 255) {
-                // un multiply
-                red = (red * 255) / alpha;
-                green = (green * 255) / alpha;
-                blue = (blue * 255) / alpha;
-            }
-            int luminosity = int(0.299f * red + 0.587f * green + 0.114f * blue);
-            *pixel = luminosity << 24;
-            pixel++;
-        }
+    for (uint row = 0; row < mHeight; row++) {
+        vLumaMatte((uint32_t *)(dataPtr + mStride * row), int(mWidth));
     }
 }
 
@@ -2970,14 +4836,65 @@ VBitmap::Format VBitmap::format() const
     return mImpl ? mImpl->format() : VBitmap::Format::Invalid;
 }
 
-void VBitmap::fill(uint pixel)
+void VBitmap::fill(uint pixel)
+{
+    if (mImpl) mImpl->fill(pixel);
+}
+
+void VBitmap::updateLuma()
+{
+    if (mImpl) mImpl->updateLuma();
+}
+
+// every destination pixel averages a 2x2 block, odd sizes round up and
+// repeat the last row / column. premultiplied channels average directly.
+static void vBitmapHalve(const VBitmap &src, VBitmap &dst)
+{
+    const uint sw = uint(src.width()), sh = uint(src.height());
+    const uint dw = uint(dst.width()), dh = uint(dst.height());
+    for (uint y = 0; y < dh; y++) {
+        const uint *row0 = (const uint *)(src.data() + src.stride() * (2 * y));
+        const uint *row1 = (const uint *)(src.data() + src.stride() * std::min(2 * y + 1, sh - 1));
+        uint *      out = (uint *)(dst.data() + dst.stride() * y);
+        for (uint x = 0; x < dw; x++) {
+            const uint x0 = 2 * x, x1 = std::min(2 * x + 1, sw - 1);
+            const uint p0 = row0[x0], p1 = row0[x1], p2 = row1[x0], p3 = row1[x1];
+            // four 8 bit channels sum to at most 10 bits, two per word
+            uint rb = (p0 & 0x00ff00ff) + (p1 & 0x00ff00ff) + (p2 & 0x00ff00ff) +
+                      (p3 & 0x00ff00ff) + 0x00020002;
+            uint ag = ((p0 >> 8) & 0x00ff00ff) + ((p1 >> 8) & 0x00ff00ff) +
+                      ((p2 >> 8) & 0x00ff00ff) + ((p3 >> 8) & 0x00ff00ff) + 0x00020002;
+            out[x] = ((rb >> 2) & 0x00ff00ff) | ((ag << 6) & 0xff00ff00);
+        }
+    }
+}
+
+VBitmap VBitmap::mipLevel(uint level) const
 {
-    if (mImpl) mImpl->fill(pixel);
+    if (!mImpl || !level || mImpl->format() != Format::ARGB32_Premultiplied) return *this;
+
+    // image assets are shared between animations drawn on other threads
+    std::lock_guard<std::mutex> guard(mImpl->mMipMutex);
+    auto &mips = mImpl->mMips;
+    while (mips.size() < level) {
+        const VBitmap &prev = mips.empty() ? *this : mips.back();
+        if (prev.width() == 1 && prev.height() == 1) break;
+        VBitmap next((prev.width() + 1) / 2, (prev.height() + 1) / 2,
+                     Format::ARGB32_Premultiplied);
+        vBitmapHalve(prev, next);
+        mips.push_back(next);
+    }
+    return mips.empty() ? *this : mips[std::min<size_t>(level, mips.size()) - 1];
 }
 
-void VBitmap::updateLuma()
+size_t VBitmap::mipBytes() const
 {
-    if (mImpl) mImpl->updateLuma();
+    if (!mImpl) return 0;
+
+    std::lock_guard<std::mutex> guard(mImpl->mMipMutex);
+    size_t bytes = 0;
+    for (const auto &mip : mImpl->mMips) bytes += mip.stride() * mip.height();
+    return bytes;
 }
 
 VGradient::VGradient(VGradient::Type type)
@@ -3278,12 +5195,29 @@ bool RjValue::IsUint64() const { return vcast(v_).IsUint64(); }
 bool RjValue::IsDouble() const { return vcast(v_).IsDouble(); }
 bool RjValue::IsString() const { return vcast(v_).IsString(); }
 
+// Insitu stream which stores a byte only when it differs from the source.
+// Unescaped strings are left as they are, so copy-on-write pages of a mapped
+// file stay shared except where strings get their terminator.
+struct RjLazyInsituStringStream : rapidjson::InsituStringStream {
+    explicit RjLazyInsituStringStream(Ch *src) : rapidjson::InsituStringStream(src) {}
+    void Put(Ch c) {
+        if (*dst_ != c) *dst_ = c;
+        ++dst_;
+    }
+};
+
 RjInsituStringStream::RjInsituStringStream(char* str)
 {
-    ss_ = new rapidjson::InsituStringStream(str);
+    ss_ = new RjLazyInsituStringStream(str);
+}
+
+RjInsituStringStream::~RjInsituStringStream()
+{
+    delete static_cast<RjLazyInsituStringStream *>(ss_);
 }
 
 RjReader::RjReader() { r_ = new rapidjson::Reader(); }
+RjReader::~RjReader() { delete (rapidjson::Reader*)r_; }
 
 static rapidjson::Reader& rcast(void* p) { return *(rapidjson::Reader*)p; }
 void RjReader::IterativeParseInit() { rcast(r_).IterativeParseInit(); }
@@ -3292,7 +5226,7 @@ bool RjReader::HasParseError() const { return rcast(r_).HasParseError(); }
 bool RjReader::IterativeParseNext(int parseFlags, RjInsituStringStream& ss_, LookaheadParserHandlerBase& handler)
 {
     if (parseFlags == (rapidjson::kParseDefaultFlags | rapidjson::kParseInsituFlag))
-        return rcast(r_).IterativeParseNext<rapidjson::kParseDefaultFlags|rapidjson::kParseInsituFlag>(*(rapidjson::InsituStringStream*)(ss_.ss_), handler);
+        return rcast(r_).IterativeParseNext<rapidjson::kParseDefaultFlags|rapidjson::kParseInsituFlag>(*(RjLazyInsituStringStream*)(ss_.ss_), handler);
     else 
         return false;
 }
@@ -4006,14 +5940,15 @@ LOTAsset* LottieParserImpl::parseAsset()
         }
     }
 
+    // images are decoded when a layer first shows them, see LOTAsset::bitmap()
     if (asset->mAssetType == LOTAsset::Type::Image) {
         if (embededResource) {
             // embeder resource should start with "data:"
             if (filename.compare(0, 5, "data:") == 0) {
-                asset->loadImageData(convertFromBase64(filename));
+                asset->setImageSource(std::move(filename), true);
             }
         } else {
-            asset->loadImagePath(mDirPath + relativePath + filename);
+            asset->setImageSource(mDirPath + relativePath + filename, false);
         }
     }
 
@@ -5156,6 +7091,11 @@ VInterpolator* LottieParserImpl::interpolator(VPointF inTangent, VPointF outTang
     }
 
     auto obj = allocator().make<VInterpolator>(outTangent, inTangent);
+#if !defined(IMLOTTIE_EXACT_EASING)
+    // built once per unique curve, keyframes share it through the cache.
+    // IMLOTTIE_EXACT_EASING keeps solving the curve on every evaluation.
+    obj->buildLut();
+#endif
     mInterpolatorCache[key] = obj;
     return obj;
 }
@@ -5872,15 +7812,135 @@ void LOTGradient::update(std::unique_ptr<VGradient> &grad, int frameNo)
     }
 }
 
-void LOTAsset::loadImageData(std::string data)
+// Decoded image assets of all loaded models, least recently used ones go
+// away when they take more than the budget. Layers showing an image keep
+// their own reference, so eviction only drops images nobody draws.
+class LottieImageCache {
+public:
+    static LottieImageCache &instance()
+    {
+        static LottieImageCache CACHE;
+        return CACHE;
+    }
+    bool find(const std::string &key, VBitmap &bitmap)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        auto search = mHash.find(key);
+        if (search == mHash.end()) return false;
+        // move to the front of the lru list.
+        mLru.splice(mLru.begin(), mLru, search->second);
+        bitmap = search->second->bitmap;
+        return true;
+    }
+    // failed decodes are kept as invalid bitmap so they are not retried
+    void add(const std::string &key, const VBitmap &bitmap)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mDecoded++;
+        if (mHash.find(key) != mHash.end()) return;
+
+        mLru.push_front({key, 0, bitmap});
+        mHash[key] = mLru.begin();
+        recount();
+        trim();
+    }
+    void remove(const std::string &key)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        auto search = mHash.find(key);
+        if (search == mHash.end()) return;
+        mUsed -= search->second->size;
+        mLru.erase(search->second);
+        mHash.erase(search);
+    }
+    void configureBudget(size_t bytes)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mBudget = bytes;
+        recount();
+        trim();
+    }
+    void stats(size_t &bytes, size_t &entries, size_t &decoded)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        recount();
+        bytes = mUsed;
+        entries = mHash.size();
+        decoded = mDecoded;
+    }
+private:
+    struct Entry {
+        std::string key;
+        size_t      size;
+        VBitmap     bitmap;
+    };
+
+    LottieImageCache() = default;
+
+    // mip levels of smoothed images are built when first drawn, long after
+    // add(), so sizes are taken again whenever the budget is looked at.
+    void recount()
+    {
+        mUsed = 0;
+        for (auto &entry : mLru) {
+            const VBitmap &bitmap = entry.bitmap;
+            entry.size = bitmap.valid() ? bitmap.stride() * bitmap.height() + bitmap.mipBytes() : 0;
+            mUsed += entry.size;
+        }
+    }
+    void trim()
+    {
+        while (mUsed > mBudget && !mLru.empty()) {
+            mUsed -= mLru.back().size;
+            mHash.erase(mLru.back().key);
+            mLru.pop_back();
+        }
+    }
+
+    std::list<Entry>                                              mLru;
+    std::unordered_map<std::string, std::list<Entry>::iterator>   mHash;
+    std::mutex                                                    mMutex;
+    size_t                                                        mBudget{32 * 1024 * 1024};
+    size_t                                                        mUsed{0};
+    size_t                                                        mDecoded{0};
+};
+
+LOTAsset::~LOTAsset()
+{
+    if (!mImageKey.empty()) LottieImageCache::instance().remove(mImageKey);
+}
+
+void LOTAsset::setImageSource(std::string source, bool embedded)
 {
-    if (!data.empty())
-        mBitmap = VImageLoader::instance().load(data.c_str(), data.length());
+    static std::atomic<uint64_t> serial{0};
+
+    if (source.empty()) return;
+    mImageSource = std::move(source);
+    mImageEmbedded = embedded;
+    // ref ids repeat between files ("image_0"), serial keeps models apart
+    mImageKey = mRefId + "#" + std::to_string(serial++);
 }
 
-void LOTAsset::loadImagePath(std::string path)
+VBitmap LOTAsset::bitmap() const
 {
-    if (!path.empty()) mBitmap = VImageLoader::instance().load(path.c_str());
+    if (mImageKey.empty()) return VBitmap();
+
+    auto &cache = LottieImageCache::instance();
+    VBitmap result;
+    if (cache.find(mImageKey, result)) return result;
+
+    // decoded outside the cache lock, when two threads race for the same
+    // image the first one added wins.
+    if (mImageEmbedded) {
+        std::string data = convertFromBase64(mImageSource);
+        if (!data.empty()) result = VImageLoader::instance().load(data.c_str(), data.length());
+    } else {
+        result = VImageLoader::instance().load(mImageSource.c_str());
+    }
+    cache.add(mImageKey, result);
+    return result;
 }
 
 std::vector<LayerInfo> LOTCompositionData::layerInfoList() const
@@ -5899,6 +7959,9 @@ std::vector<LayerInfo> LOTCompositionData::layerInfoList() const
     return result;
 }
 
+// Least recently used set of parsed models shared by every Animation.
+// Entries handed out are shared_ptr copies, so evicting a model that is
+// still rendered somewhere only drops the cache's reference.
 class LottieModelCache {
 public:
     static LottieModelCache &instance()
@@ -5906,9 +7969,71 @@ public:
         static LottieModelCache CACHE;
         return CACHE;
     }
-    std::shared_ptr<LOTModel> find(const std::string &) { return nullptr; }
-    void add(const std::string &, std::shared_ptr<LOTModel>) {}
-    void configureCacheSize(size_t) {}
+    std::shared_ptr<LOTModel> find(const std::string &key)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        if (!mCacheSize) return nullptr;
+
+        auto search = mHash.find(key);
+        if (search == mHash.end()) {
+            mMisses++;
+            return nullptr;
+        }
+        mHits++;
+        // move to the front of the lru list.
+        mLru.splice(mLru.begin(), mLru, search->second);
+        return search->second->second;
+    }
+    void add(const std::string &key, std::shared_ptr<LOTModel> value)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+
+        if (!mCacheSize) return;
+
+        auto search = mHash.find(key);
+        if (search != mHash.end()) {
+            search->second->second = std::move(value);
+            mLru.splice(mLru.begin(), mLru, search->second);
+            return;
+        }
+
+        mLru.emplace_front(key, std::move(value));
+        mHash[key] = mLru.begin();
+        trim();
+    }
+    void configureCacheSize(size_t cacheSize)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        mCacheSize = cacheSize;
+        trim();
+    }
+    void stats(size_t &hits, size_t &misses, size_t &entries)
+    {
+        std::lock_guard<std::mutex> guard(mMutex);
+        hits = mHits;
+        misses = mMisses;
+        entries = mHash.size();
+    }
+private:
+    using Entry = std::pair<std::string, std::shared_ptr<LOTModel>>;
+
+    LottieModelCache() = default;
+
+    void trim()
+    {
+        while (mHash.size() > mCacheSize) {
+            mHash.erase(mLru.back().first);
+            mLru.pop_back();
+        }
+    }
+
+    std::list<Entry>                                              mLru;
+    std::unordered_map<std::string, std::list<Entry>::iterator>   mHash;
+    std::mutex                                                    mMutex;
+    size_t                                                        mCacheSize{16};
+    size_t                                                        mHits{0};
+    size_t                                                        mMisses{0};
 };
 
 void LottieLoader::configureModelCacheSize(size_t cacheSize)
@@ -5927,34 +8052,151 @@ static std::string dirname(const std::string &path)
 }
 
 
-bool LottieLoader::load(const std::string &path, bool cachePolicy)
+// 64bit FNV-1a, used to tell apart different revisions of the same file.
+static uint64_t contentHash(const char *data, size_t size)
 {
-    if (cachePolicy) {
-        mModel = LottieModelCache::instance().find(path);
-        if (mModel) return true;
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Private copy-on-write view of a json file. Parser works in place, pages
+// it doesn't write (numbers, unescaped strings, base64 images) stay shared
+// with the file cache instead of being read into a heap copy.
+class LottieFileMapping {
+public:
+    LottieFileMapping() = default;
+    LottieFileMapping(const LottieFileMapping &) = delete;
+    LottieFileMapping &operator=(const LottieFileMapping &) = delete;
+    ~LottieFileMapping() { close(); }
+
+    bool open(const std::string &path) {
+        close();
+        uint64_t size = 0;
+#if !defined(IMLOTTIE_STANDALONE)
+        HANDLE file = Imm::Storage::Manage::CreateFile(path);
+        if (file == INVALID_HANDLE_VALUE || !file) return false;
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && usable(size = uint64_t(fileSize.QuadPart))) {
+            HANDLE mapping = CreateFileMappingFromApp(file, nullptr, PAGE_WRITECOPY, 0, nullptr);
+            if (mapping) {
+                mData = static_cast<char *>(MapViewOfFileFromApp(mapping, FILE_MAP_COPY, 0, 0));
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#elif defined(_WIN32)
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (GetFileSizeEx(file, &fileSize) && usable(size = uint64_t(fileSize.QuadPart))) {
+            HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+            if (mapping) {
+                mData = static_cast<char *>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+                CloseHandle(mapping);
+            }
+        }
+        CloseHandle(file);
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) == 0 && usable(size = uint64_t(st.st_size))) {
+            void *data = mmap(nullptr, size_t(size), PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (data != MAP_FAILED) mData = static_cast<char *>(data);
+        }
+        ::close(fd);
+#endif
+        if (!mData) return false;
+        mSize = size_t(size);
+        return true;
+    }
+
+    void close() {
+        if (!mData) return;
+#if defined(_WIN32) || !defined(IMLOTTIE_STANDALONE)
+        UnmapViewOfFile(mData);
+#else
+        munmap(mData, mSize);
+#endif
+        mData = nullptr;
+        mSize = 0;
+    }
+
+    char * data() const { return mData; }
+    size_t size() const { return mSize; }
+
+private:
+    // parser stops at the nul past the json, only the zero filled tail of
+    // the last page provides it. Files ending on a page boundary are read.
+    static bool usable(uint64_t size) {
+        return size > 0 && size < SIZE_MAX && (size % 4096) != 0;
     }
 
-    // Read contents
-	bool state = false;
-    std::string content= Imm::Storage::Stream::FileGetContents(state, path, "r");
+    char * mData{nullptr};
+    size_t mSize{0};
+};
+
+bool LottieLoader::load(const std::string &path, bool cachePolicy)
+{
+    LottieFileMapping mapping;
+    std::string content;
+    char *data = nullptr;
+    size_t size = 0;
+    if (mapping.open(path)) {
+        data = mapping.data();
+        size = mapping.size();
+    } else {
+        // Read contents
+#if defined(IMLOTTIE_STANDALONE)
+        std::ifstream file(path, std::ios::binary);
+        if (!file) {
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        content = buffer.str();
+#else
+        bool state = false;
+        content = Imm::Storage::Stream::FileGetContents(state, path, "r");
 
-	if (!state) {
-		return { };
-	}
+        if (!state) {
+            return { };
+        }
+#endif
+        data = &content[0];
+        size = content.size();
+    }
 
-    if (content.empty()) {
+    if (!size) {
         return false;
     }
 
-    const char *str = content.c_str();
-    LottieParser parser(const_cast<char *>(str),
-                        dirname(path).c_str());
-    mModel = parser.model();
+    // UWP storage gives no cheap mtime, so the key carries a hash of the
+    // contents instead. A file edited on disk gets a fresh cache entry.
+    std::string key;
+    if (cachePolicy) {
+        char hash[17];
+        snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)contentHash(data, size));
+        key = path + "#" + hash;
+        mModel = LottieModelCache::instance().find(key);
+        if (mModel) return true;
+    }
+
+    {
+        LOTTIE_TRACE_SCOPE(Parse);
+        LottieParser parser(data, dirname(path).c_str());
+        mModel = parser.model();
+    }
 
     if (!mModel) return false;
 
     if (cachePolicy) {
-        LottieModelCache::instance().add(path, mModel);
+        LottieModelCache::instance().add(key, mModel);
     }
 
     return true;
@@ -5968,9 +8210,12 @@ bool LottieLoader::loadFromData(std::string &&jsonData, const std::string &key,
         if (mModel) return true;
     }
 
-    LottieParser parser(const_cast<char *>(jsonData.c_str()),
-                        resourcePath.c_str());
-    mModel = parser.model();
+    {
+        LOTTIE_TRACE_SCOPE(Parse);
+        LottieParser parser(const_cast<char *>(jsonData.c_str()),
+                            resourcePath.c_str());
+        mModel = parser.model();
+    }
 
     if (!mModel) return false;
 
@@ -6180,25 +8425,129 @@ bool LOTCompItem::update(int frameNo, const VSize &size, bool keepAspectRatio)
     return true;
 }
 
+bool LOTCompItem::canRenderPartial(const imlottie::Surface &surface) const
+{
+    return (mRetained.buffer == surface.buffer()) &&
+           (mRetained.width == surface.width()) &&
+           (mRetained.height == surface.height()) &&
+           (mRetained.bytesPerLine == surface.bytesPerLine()) &&
+           (mRetained.drawRegion ==
+            VRect(int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
+                  int(surface.drawRegionWidth()), int(surface.drawRegionHeight())));
+}
+
+static VRect unite(const VRect &a, const VRect &b);
+
+static int area(const VRect &r)
+{
+    return r.empty() ? 0 : r.width() * r.height();
+}
+
+/*
+ * Every render pass walks the whole layer tree, so keep only a few
+ * rects around. Overlapping rects are merged as long as the union doesn't
+ * cover more than both did, once the limit is hit a rect goes to the
+ * neighbour it grows the least.
+ */
+void LOTCompItem::mergeDirtyRects(const VRect &clip)
+{
+    constexpr size_t kMaxDirtyRects = 4;
+
+    size_t count = 0;
+    int    dirtyArea = 0;
+    for (const auto &i : mDirtyRects) {
+        VRect rect = i & clip;
+        if (rect.empty()) continue;
+
+        size_t best = count;
+        int    bestGrowth = 0;
+        for (size_t j = 0; j < count; ++j) {
+            const VRect &other = mDirtyRects[j];
+            int united = area(unite(other, rect));
+            if (united <= area(other) + area(rect)) {
+                best = j;
+                break;
+            }
+            int growth = united - area(other);
+            if (count == kMaxDirtyRects && (best == count || growth < bestGrowth)) {
+                best = j;
+                bestGrowth = growth;
+            }
+        }
+
+        if (best == count) {
+            mDirtyRects[count++] = rect;
+        } else {
+            mDirtyRects[best] = unite(mDirtyRects[best], rect);
+        }
+    }
+    mDirtyRects.resize(count);
+
+    for (const auto &i : mDirtyRects) dirtyArea += area(i);
+
+    // not worth several passes when most of the frame changed.
+    if (count > 1 && dirtyArea * 4 >= area(clip) * 3) {
+        mDirtyRects.clear();
+        mDirtyRects.push_back(clip);
+    }
+}
+
 bool LOTCompItem::render(const imlottie::Surface &surface)
 {
+    bool partial = surface.isPartialUpdate() && canRenderPartial(surface);
+
     mSurface.reset(reinterpret_cast<uchar *>(surface.buffer()),
                    uint(surface.width()), uint(surface.height()), uint(surface.bytesPerLine()),
                    VBitmap::Format::ARGB32_Premultiplied);
-    mSurface.setNeedClear(surface.isNeedClear());
+    // partial update clears only the dirty rects.
+    mSurface.setNeedClear(partial ? false : surface.isNeedClear());
 
     /* schedule all preprocess task for this frame at once.
     */
     VRect clip(0, 0, int(surface.drawRegionWidth()), int(surface.drawRegionHeight()));
+    VRect drawRegion(int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
+                     int(surface.drawRegionWidth()), int(surface.drawRegionHeight()));
+    auto start = std::chrono::steady_clock::now();
     mRootLayer->preprocess(clip);
+    auto rasterized = std::chrono::steady_clock::now();
+
+    mDirtyRects.clear();
+    if (surface.isPartialUpdate()) {
+        // the layer tree keeps track from the previous collection, so do
+        // it on every frame of a retained buffer, even a full repaint.
+        mRootLayer->collectDirtyRects(mDirtyRects);
+        mRetained.buffer = surface.buffer();
+        mRetained.width = surface.width();
+        mRetained.height = surface.height();
+        mRetained.bytesPerLine = surface.bytesPerLine();
+        mRetained.drawRegion = drawRegion;
+    } else {
+        mRetained.buffer = nullptr;
+    }
+
+    if (partial) {
+        mergeDirtyRects(clip);
+    } else {
+        mDirtyRects.clear();
+        mDirtyRects.push_back(clip);
+    }
 
     VPainter painter(&mSurface);
     // set sub surface area for drawing.
-    painter.setDrawRegion(
-        VRect(int(surface.drawRegionPosX()), int(surface.drawRegionPosY()),
-        int(surface.drawRegionWidth()), int(surface.drawRegionHeight())));
-    mRootLayer->render(&painter, {}, {});
+    painter.setDrawRegion(drawRegion);
+    if (partial) {
+        for (const auto &rect : mDirtyRects) {
+            painter.setClipRect(rect);
+            painter.clear();
+            mRootLayer->render(&painter, {}, {});
+        }
+    } else {
+        mRootLayer->render(&painter, {}, {});
+    }
     painter.end();
+
+    mTimings.rasterize = std::chrono::duration<double, std::milli>(rasterized - start).count();
+    mTimings.blend = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - rasterized).count();
     return true;
 }
 
@@ -6316,7 +8665,7 @@ void LOTLayerMaskItem::update(int frameNo, const VMatrix &parentMatrix,
 
 VRle LOTLayerMaskItem::maskRle(const VRect &clipRect)
 {
-    if (!mDirty) return mRle;
+    if (!mDirty && mClip == clipRect) return mRle;
 
     VRle rle;
     for (auto &i : mMasks) {
@@ -6349,6 +8698,7 @@ VRle LOTLayerMaskItem::maskRle(const VRect &clipRect)
     } else {
         mRle = rle;
     }
+    mClip = clipRect;
     mDirty = false;
     return mRle;
 }
@@ -6416,6 +8766,8 @@ void LOTLayerItem::update(int frameNumber, const VMatrix &parentMatrix,
         return;
     }
 
+    if (!flag().testFlag(DirtyFlagBit::None)) mContentChanged = true;
+
     // 2. calculate the parent matrix and alpha
     VMatrix m = matrix(frameNo());
     m *= parentMatrix;
@@ -6435,6 +8787,7 @@ void LOTLayerItem::update(int frameNumber, const VMatrix &parentMatrix,
     if (mLayerMask) {
         mLayerMask->update(frameNo(), mCombinedMatrix, mCombinedAlpha,
                            mDirtyFlag);
+        if (!mLayerMask->isStatic()) mContentChanged = true;
     }
 
     // 5. if no parent property change and layer is static then nothing to do.
@@ -6444,6 +8797,8 @@ void LOTLayerItem::update(int frameNumber, const VMatrix &parentMatrix,
 
     // 6. update the content of the layer
     updateContent();
+    // precomp layers report their changes through the child layers.
+    if (!mLayerData->precompLayer()) mContentChanged = true;
 
     // 7. reset the dirty flag
     mDirtyFlag = DirtyFlagBit::None;
@@ -6516,14 +8871,16 @@ void LOTCompLayerItem::render(VPainter *painter, const VRle &inheritMask,
         renderHelper(painter, inheritMask, matteRle);
     } else {
         if (complexContent()) {
-            VSize    size = painter->clipBoundingRect().size();
+            VRect region = renderBounds() & painter->clipBoundingRect();
+            if (region.empty()) return;
             VPainter srcPainter;
-            VBitmap  srcBitmap(size.width(), size.height(),
+            mAlphaBuffer.reset(region.width(), region.height(),
                                VBitmap::Format::ARGB32_Premultiplied);
-            srcPainter.begin(&srcBitmap);
+            srcPainter.begin(&mAlphaBuffer, VPoint(region.x(), region.y()));
             renderHelper(&srcPainter, inheritMask, matteRle);
             srcPainter.end();
-            painter->drawBitmap(VPoint(), srcBitmap, uchar(combinedAlpha() * 255.0f));
+            painter->drawBitmap(VPoint(region.x(), region.y()), mAlphaBuffer,
+                                uchar(combinedAlpha() * 255.0f));
         } else {
             renderHelper(painter, inheritMask, matteRle);
         }
@@ -6571,21 +8928,30 @@ void LOTCompLayerItem::renderMatteLayer(VPainter *painter, const VRle &mask,
                                         const VRle &  matteRle,
                                         LOTLayerItem *layer, LOTLayerItem *src)
 {
-    VSize size = painter->clipBoundingRect().size();
-    // Decide if we can use fast matte.
+    // Only the area both layers can touch matters for alpha/luma mattes,
+    // inverted mattes can only ever show the layer itself. Offscreen
+    // buffers are sized to that area instead of the whole canvas.
+    VRect region = layer->renderBounds() & painter->clipBoundingRect();
+    if (layer->matteType() == MatteType::Alpha ||
+        layer->matteType() == MatteType::Luma) {
+        region = region & src->renderBounds();
+    }
+    if (region.empty()) return;
+    VPoint origin(region.x(), region.y());
+
     // 1. draw src layer to matte buffer
     VPainter srcPainter;
-    src->bitmap().reset(size.width(), size.height(),
+    src->bitmap().reset(region.width(), region.height(),
                         VBitmap::Format::ARGB32_Premultiplied);
-    srcPainter.begin(&src->bitmap());
+    srcPainter.begin(&src->bitmap(), origin);
     src->render(&srcPainter, mask, matteRle);
     srcPainter.end();
 
     // 2. draw layer to layer buffer
     VPainter layerPainter;
-    layer->bitmap().reset(size.width(), size.height(),
+    layer->bitmap().reset(region.width(), region.height(),
                           VBitmap::Format::ARGB32_Premultiplied);
-    layerPainter.begin(&layer->bitmap());
+    layerPainter.begin(&layer->bitmap(), origin);
     layer->render(&layerPainter, mask, matteRle);
 
     // 2.1update composition mode
@@ -6611,10 +8977,91 @@ void LOTCompLayerItem::renderMatteLayer(VPainter *painter, const VRle &mask,
     }
 
     // 2.3 draw src buffer as mask
-    layerPainter.drawBitmap(VPoint(), src->bitmap());
+    layerPainter.drawBitmap(origin, src->bitmap());
     layerPainter.end();
     // 3. draw the result buffer into painter
-    painter->drawBitmap(VPoint(), layer->bitmap());
+    painter->drawBitmap(origin, layer->bitmap());
+}
+
+static VRect unite(const VRect &a, const VRect &b)
+{
+    if (a.empty()) return b;
+    if (b.empty()) return a;
+    int left = std::min(a.left(), b.left());
+    int top = std::min(a.top(), b.top());
+    return VRect(left, top, std::max(a.right(), b.right()) - left,
+                 std::max(a.bottom(), b.bottom()) - top);
+}
+
+// conservative area a layer paints this frame, masks and mattes ignored.
+VRect LOTLayerItem::renderBounds()
+{
+    VRect bounds;
+    for (auto &i : renderList()) bounds = unite(bounds, i->rle().boundingRect());
+    return bounds;
+}
+
+VRect LOTCompLayerItem::renderBounds()
+{
+    VRect bounds;
+    for (const auto &layer : mLayers) {
+        if (layer->visible()) bounds = unite(bounds, layer->renderBounds());
+    }
+    return bounds;
+}
+
+// area that changed since the previous call: old and new bounds of every
+// layer whose content, transform, opacity or visibility moved.
+void LOTLayerItem::collectDirtyRects(std::vector<VRect> &rects)
+{
+    VRect bounds = renderBounds();
+    if (mContentChanged || bounds != mLastBounds) {
+        VRect dirty = unite(mLastBounds, bounds);
+        if (!dirty.empty()) rects.push_back(dirty);
+    }
+    mLastBounds = bounds;
+    mContentChanged = false;
+}
+
+void LOTCompLayerItem::collectDirtyRects(std::vector<VRect> &rects)
+{
+    VRect bounds = skipRendering() ? VRect() : renderBounds();
+    size_t first = rects.size();
+
+    // children of a hidden comp are not updated, pick them up again once
+    // it shows.
+    if (!skipRendering()) {
+        LOTLayerItem *matte = nullptr;
+        for (const auto &layer : mLayers) {
+            if (layer->hasMatte()) {
+                matte = layer;
+                continue;
+            }
+            size_t mark = rects.size();
+            if (matte) matte->collectDirtyRects(rects);
+            layer->collectDirtyRects(rects);
+            // visibility of the matte source decides if the matte
+            // layer draws at all.
+            if (matte && rects.size() > mark) {
+                VRect dirty = matte->renderBounds();
+                for (size_t i = mark; i < rects.size(); ++i)
+                    dirty = unite(dirty, rects[i]);
+                rects.resize(mark);
+                rects.push_back(dirty);
+            }
+            matte = nullptr;
+        }
+    }
+
+    // transform, opacity, mask or clipper of the comp changed, or it got
+    // shown or hidden: everything it draws is dirty.
+    if (mContentChanged || bounds.empty() || mLastBounds.empty()) {
+        rects.resize(first);
+        VRect dirty = unite(mLastBounds, bounds);
+        if (!dirty.empty()) rects.push_back(dirty);
+    }
+    mLastBounds = bounds;
+    mContentChanged = false;
 }
 
 void LOTClipperItem::update(const VMatrix &matrix)
@@ -6726,11 +9173,18 @@ LOTImageLayerItem::LOTImageLayerItem(LOTLayerData *layerData)
 
     if (!mLayerData->asset()) return;
 
-    mTexture.mBitmap = mLayerData->asset()->bitmap();
     VBrush brush(&mTexture);
     mRenderNode.setBrush(brush);
 }
 
+void LOTImageLayerItem::loadTexture()
+{
+    if (mTextureLoaded || !mLayerData->asset()) return;
+
+    mTexture.mBitmap = mLayerData->asset()->bitmap();
+    mTextureLoaded = true;
+}
+
 void LOTImageLayerItem::updateContent()
 {
     if (!mLayerData->asset()) return;
@@ -6752,12 +9206,20 @@ void LOTImageLayerItem::updateContent()
 
 void LOTImageLayerItem::preprocessStage(const VRect& clip)
 {
+    loadTexture();
     mRenderNode.preprocess(clip);
 }
 
 DrawableList LOTImageLayerItem::renderList()
 {
-    if (skipRendering()) return {};
+    if (skipRendering()) {
+        // hidden layer lets the cache decide whether the image stays
+        if (mTextureLoaded) {
+            mTexture.mBitmap = VBitmap();
+            mTextureLoaded = false;
+        }
+        return {};
+    }
 
     return {&mDrawableList , 1};
 }
@@ -6834,6 +9296,8 @@ LOTShapeLayerItem::LOTShapeLayerItem(LOTLayerData *layerData, VArenaAlloc* alloc
     if (layerData->hasPathOperator()) {
         list.clear();
         mRoot->processTrimItems(list);
+        // trim rewrites paths of nested groups every frame
+        mRoot->markDynamic();
     }
 }
 
@@ -6879,6 +9343,7 @@ bool LOTContentGroupItem::resolveKeyPath(LOTKeyPath &keyPath, uint depth,
             if (keyPath.fullyResolvesTo(mModel.name(), depth) &&
                 transformProp(value.property())) {
                 mModel.filter().addValue(value);
+                mStaticSubtree = false;
             }
         }
     }
@@ -6886,12 +9351,23 @@ bool LOTContentGroupItem::resolveKeyPath(LOTKeyPath &keyPath, uint depth,
     if (keyPath.propagate(name(), depth)) {
         uint newDepth = keyPath.nextDepth(name(), depth);
         for (auto &child : mContents) {
-            child->resolveKeyPath(keyPath, newDepth, value);
+            // dynamic property below, parser flags no longer hold
+            if (child->resolveKeyPath(keyPath, newDepth, value)) mStaticSubtree = false;
         }
     }
     return true;
 }
 
+void LOTContentGroupItem::markDynamic()
+{
+    mStaticSubtree = false;
+    for (auto &child : mContents) {
+        if (child->type() == ContentType::Group) {
+            static_cast<LOTContentGroupItem *>(child)->markDynamic();
+        }
+    }
+}
+
 bool LOTFillItem::resolveKeyPath(LOTKeyPath &keyPath, uint depth,
                                  LOTVariant &value)
 {
@@ -6926,6 +9402,7 @@ LOTContentGroupItem::LOTContentGroupItem(LOTGroupData *data, VArenaAlloc* alloca
     : mModel(data)
 {
     addChildren(data, allocator);
+    mStaticSubtree = data && data->isStatic();
 }
 
 void LOTContentGroupItem::addChildren(LOTGroupData *data, VArenaAlloc* allocator)
@@ -6941,6 +9418,10 @@ void LOTContentGroupItem::addChildren(LOTGroupData *data, VArenaAlloc* allocator
         auto content = createContentItem(*it, allocator);
         if (content) {
             mContents.push_back(content);
+            mSubtreeItems++;
+            if (content->type() == ContentType::Group) {
+                mSubtreeItems += static_cast<LOTContentGroupItem *>(content)->mSubtreeItems;
+            }
         }
     }
 }
@@ -6948,6 +9429,20 @@ void LOTContentGroupItem::addChildren(LOTGroupData *data, VArenaAlloc* allocator
 void LOTContentGroupItem::update(int frameNo, const VMatrix &parentMatrix,
                                  float parentAlpha, const DirtyFlag &flag)
 {
+    // static subtree under unchanged parent, paths, paints and their rle
+    // are as the last update left them.
+    if (mStaticSubtree && flag.testFlag(DirtyFlagBit::None)) {
+        if (mSettled) {
+            LOTTIE_TRACE_COUNT(itemsSkipped, mSubtreeItems);
+            return;
+        }
+        // one more pass clears the dirty state of the items
+        mSettled = true;
+    } else {
+        mSettled = false;
+    }
+    LOTTIE_TRACE_COUNT(itemsUpdated, mContents.size());
+
     DirtyFlag newFlag = flag;
     float alpha;
 
@@ -7657,6 +10152,7 @@ void LOTImageLayerItem::buildLayerNode()
     LOTLayerItem::buildLayerNode();
 
     auto renderlist = renderList();
+    if (!renderlist.empty()) loadTexture();
 
     cnodes().clear();
     for (auto &i : renderlist) {
@@ -7835,6 +10331,72 @@ void configureModelCacheSize(size_t cacheSize)
     LottieLoader::configureModelCacheSize(cacheSize);
 }
 
+void modelCacheStats(size_t &hits, size_t &misses, size_t &entries)
+{
+    LottieModelCache::instance().stats(hits, misses, entries);
+}
+
+void configureImageCacheSize(size_t bytes)
+{
+    LottieImageCache::instance().configureBudget(bytes);
+}
+
+void imageCacheStats(size_t &bytes, size_t &entries, size_t &decoded)
+{
+    LottieImageCache::instance().stats(bytes, entries, decoded);
+}
+
+void gradientCacheStats(size_t &hits, size_t &misses, size_t &builds)
+{
+    VGradientCache::instance().stats(hits, misses, builds);
+}
+
+void configureRasterThreads(int count)
+{
+    RleTaskScheduler::threadsOverride() = count;
+}
+
+void shutdownRasterThreads()
+{
+    RleTaskScheduler::instance().stop();
+}
+
+void configureRleBands(size_t spans)
+{
+    rleBandSpans() = spans;
+}
+
+void configureImageSmoothing(bool enable)
+{
+    imageSmoothing() = enable;
+}
+
+std::string traceSummary()
+{
+#if defined(IMLOTTIE_TRACE)
+    return trace::Recorder::instance().summary();
+#else
+    return std::string();
+#endif
+}
+
+bool traceExport(const std::string &path)
+{
+#if defined(IMLOTTIE_TRACE)
+    return trace::Recorder::instance().exportJson(path);
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void traceReset()
+{
+#if defined(IMLOTTIE_TRACE)
+    trace::Recorder::instance().reset();
+#endif
+}
+
 struct RenderTask {
     RenderTask() { receiver = sender.get_future(); }
     std::promise<Surface> sender;
@@ -7856,6 +10418,8 @@ public:
     size_t  totalFrame() const { return mModel->totalFrame(); }
     size_t  frameAtPos(double pos) const { return mModel->frameAtPos(pos); }
     Surface render(size_t frameNo, const Surface &surface, bool keepAspectRatio);
+    const std::vector<Rect> &dirtyRegion() const { return mDirtyRegion; }
+    const RenderTimings &renderTimings() const { return mTimings; }
 
     const LOTLayerNode * renderTree(size_t frameNo, const VSize &size);
 
@@ -7878,6 +10442,8 @@ private:
     std::string                  mFilePath;
     std::shared_ptr<LOTModel>    mModel;
     std::unique_ptr<LOTCompItem> mCompItem;
+    std::vector<Rect>            mDirtyRegion;
+    RenderTimings                mTimings;
     SharedRenderTask             mTask;
     std::atomic<bool>            mRenderInProgress;
 };
@@ -7916,9 +10482,27 @@ Surface AnimationImpl::render(size_t frameNo, const Surface &surface, bool keepA
     }
 
     mRenderInProgress.store(true);
-    update(frameNo,
-           VSize(int(surface.drawRegionWidth()), int(surface.drawRegionHeight())), keepAspectRatio);
+    LOTTIE_TRACE_SCOPE(Frame);
+    auto start = std::chrono::steady_clock::now();
+    {
+        LOTTIE_TRACE_SCOPE(Update);
+        update(frameNo,
+               VSize(int(surface.drawRegionWidth()), int(surface.drawRegionHeight())), keepAspectRatio);
+    }
+    auto updated = std::chrono::steady_clock::now();
     mCompItem->render(surface);
+
+    mTimings = mCompItem->timings();
+    mTimings.update = std::chrono::duration<double, std::milli>(updated - start).count();
+
+    // report in surface coordinates.
+    mDirtyRegion.clear();
+    for (const auto &i : mCompItem->dirtyRects()) {
+        mDirtyRegion.emplace_back(surface.drawRegionPosX() + size_t(i.x()),
+                                  surface.drawRegionPosY() + size_t(i.y()),
+                                  size_t(i.width()), size_t(i.height()));
+    }
+    LOTTIE_TRACE_FRAME();
     mRenderInProgress.store(false);
 
     return surface;
@@ -8026,6 +10610,16 @@ void Animation::renderSync(size_t frameNo, Surface surface, bool keepAspectRatio
     d->render(frameNo, surface, keepAspectRatio);
 }
 
+const std::vector<Rect> &Animation::dirtyRegion() const
+{
+    return d->dirtyRegion();
+}
+
+const RenderTimings &Animation::renderTimings() const
+{
+    return d->renderTimings();
+}
+
 const LayerInfoList &Animation::layers() const
 {
     return d->layerInfoList();
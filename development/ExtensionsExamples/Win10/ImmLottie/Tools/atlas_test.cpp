@@ -0,0 +1,196 @@
+/*
+ * Atlas test, packs and frees generated frames in LottieAtlas with the
+ * null (CPU only) backend and checks that regions never overlap, that
+ * freed places are reused, that pixels land where uv rects point and that
+ * every changed page is uploaded once per flush. Exit code 1 on failure.
+ *
+ * Build (any C++17 compiler), from ImmLottie folder:
+ *   g++ -std=c++17 -O2 -pthread -DIMLOTTIE_STANDALONE -ICore -IGUI \
+ *       Core/imottie_renderer.cpp Core/freetype/v_ft_*.cpp Tools/atlas_test.cpp -o atlas_test
+ *
+ * Usage:
+ *   atlas_test [options]
+ *     -n <n>            allocate / release steps of the random run, default 20000
+ *     --seed <n>        seed of the random run, default 1
+ */
+
+#include "imgui_headless.h"
+#include "imlottie.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace ImLottie;
+
+namespace {
+
+struct Options {
+    int steps = 20000;
+    uint32_t seed = 1;
+};
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+void usage() {
+    printf("usage: atlas_test [-n steps] [--seed n]\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-n" && hasValue) {
+            opt.steps = atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            opt.seed = uint32_t(strtoul(argv[++i], nullptr, 10));
+        } else {
+            return false;
+        }
+    }
+    return opt.steps > 0;
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+// padded places of two regions on the same page must not touch
+bool overlap(const LottieAtlasRegion &a, const LottieAtlasRegion &b) {
+    const int pad = LottieAtlas::PADDING;
+    return a.page == b.page && a.x - pad < b.x + b.w + pad && b.x - pad < a.x + a.w + pad &&
+           a.y - pad < b.y + b.h + pad && b.y - pad < a.y + a.h + pad;
+}
+
+bool inside(const LottieAtlasRegion &region, int pageSize) {
+    return region.x >= 0 && region.y >= 0 && region.x + region.w <= std::max(pageSize, region.w) &&
+           region.y + region.h <= std::max(pageSize, region.h);
+}
+
+// frames of icon sizes come and go, some bigger than a page
+void randomRun(const Options &opt) {
+    const int pageSize = 256;
+    LottieAtlas atlas(pageSize);
+    auto *backend = static_cast<LottieAtlasNullBackend *>(atlas.getBackend());
+    std::vector<LottieAtlasRegion> live;
+    uint32_t seed = opt.seed;
+    size_t maxPages = 0;
+
+    for (int step = 0; step < opt.steps && !failures; step++) {
+        if (live.size() < 40 && (live.empty() || nextRandom(seed) % 3)) {
+            const bool big = nextRandom(seed) % 50 == 0;
+            const int w = big ? pageSize + 10 : 8 + int(nextRandom(seed) % 90);
+            const int h = big ? 40 : 8 + int(nextRandom(seed) % 90);
+            LottieAtlasRegion region;
+            check(atlas.allocate(w, h, region), "allocate");
+            check(region.w == w && region.h == h && inside(region, pageSize), "region size");
+            for (const auto &other : live) {
+                check(!overlap(region, other), "regions overlap");
+            }
+            live.push_back(region);
+        } else {
+            const size_t index = nextRandom(seed) % live.size();
+            atlas.release(live[index]);
+            live.erase(live.begin() + index);
+        }
+        maxPages = std::max(maxPages, atlas.pageCount());
+    }
+    for (auto &region : live) {
+        atlas.release(region);
+    }
+    // last shared page stays for next frames
+    check(atlas.pageCount() <= 1 && backend->pagesAlive == atlas.pageCount(), "pages left after release");
+    printf("random run: %d steps, at most %zu pages, %u pages created\n", opt.steps, maxPages,
+           backend->pagesCreated);
+}
+
+// freed place is taken by smaller frames, rest of it stays usable
+void reuseFreedPlace() {
+    LottieAtlas atlas(256);
+    LottieAtlasRegion big, keep;
+    atlas.allocate(98, 98, big);
+    atlas.allocate(200, 30, keep);
+    const LottieAtlasRegion freed = big;
+    atlas.release(big);
+
+    int reused = 0;
+    std::vector<LottieAtlasRegion> icons(4);
+    for (auto &icon : icons) {
+        atlas.allocate(48, 48, icon);
+        if (icon.x >= freed.x - 1 && icon.y >= freed.y - 1 && icon.x + icon.w <= freed.x + freed.w + 1 &&
+            icon.y + icon.h <= freed.y + freed.h + 1) {
+            reused++;
+        }
+    }
+    printf("freed 98x98 place: %d of 4 48x48 frames packed into it\n", reused);
+    check(reused == 4, "freed place reused in full");
+    check(atlas.pageCount() == 1, "reuse keeps one page");
+}
+
+// pixels written to region show up at its uv rect, dirty pages upload once
+void uploads() {
+    const int pageSize = 128;
+    LottieAtlas atlas(pageSize);
+    auto *backend = static_cast<LottieAtlasNullBackend *>(atlas.getBackend());
+
+    std::vector<LottieAtlasRegion> icons(6);
+    std::vector<uint32_t> frame(32 * 32);
+    for (size_t i = 0; i < icons.size(); i++) {
+        atlas.allocate(32, 32, icons[i]);
+        for (size_t p = 0; p < frame.size(); p++) {
+            frame[p] = 0xff000000u | uint32_t(i << 16) | uint32_t(p);
+        }
+        atlas.write(icons[i], (const uint8_t *)frame.data(), 32 * 4, {0, 0, 32, 32});
+    }
+    atlas.flush();
+    check(backend->uploads == 1, "one upload for the page");
+
+    for (size_t i = 0; i < icons.size(); i++) {
+        const auto &icon = icons[i];
+        check(int(icon.uv0.x * pageSize + 0.5f) == icon.x && int(icon.uv1.y * pageSize + 0.5f) == icon.y + icon.h,
+              "uv rect");
+        const uint32_t *pixels = (const uint32_t *)atlas.pagePixels(icon.page);
+        for (int y = 0; y < icon.h; y++) {
+            for (int x = 0; x < icon.w; x++) {
+                if (pixels[(icon.y + y) * pageSize + icon.x + x] != (0xff000000u | uint32_t(i << 16) | uint32_t(y * 32 + x))) {
+                    check(false, "frame pixels in page");
+                    return;
+                }
+            }
+        }
+    }
+
+    // small change uploads only its page area, nothing changed uploads nothing
+    const uint64_t pixelsBefore = backend->uploadedPixels;
+    atlas.write(icons[2], (const uint8_t *)frame.data(), 32 * 4, {4, 4, 8, 8});
+    atlas.flush();
+    atlas.flush();
+    check(backend->uploads == 2 && backend->uploadedPixels - pixelsBefore == 64, "dirty area upload");
+    printf("uploads: %u for %zu frames, %llu pixels\n", backend->uploads, icons.size(),
+           (unsigned long long)backend->uploadedPixels);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    randomRun(opt);
+    reuseFreedPlace();
+    uploads();
+    printf(failures ? "atlas test failed\n" : "atlas test passed\n");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,212 @@
+/*
+ * Image blit benchmark, draws one generated image at the scales image
+ * layers end up with (icon sizes, whole and odd factors, rotated, magnified)
+ * with the default sampling and with smoothing, in target megapixels per
+ * second. By default power of two shrinks draw their mip level and the rest
+ * samples nearest pixel. Axis aligned shrinks are also checked against the
+ * exact area average.
+ *
+ * Build (any C++17 compiler), from ImmLottie folder:
+ *   g++ -std=c++17 -O2 -pthread -DIMLOTTIE_STANDALONE -ICore \
+ *       Core/imottie_renderer.cpp Core/freetype/v_ft_*.cpp Tools/blit_bench.cpp -o blit_bench
+ *
+ * Usage:
+ *   blit_bench [options]
+ *     -s <n>            source image size, default 960
+ *     --time <ms>       time spent on every case and sampler, default 200
+ */
+
+#include "imlottie_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace imlottie;
+
+namespace {
+
+struct Options {
+    int size = 960;
+    double time = 200;
+};
+
+struct Case {
+    const char *name;
+    float       scale;
+    float       angle;
+};
+
+const Case CASES[] = {
+    {"1:1", 1.0f, 0},
+    {"1/2", 1.0f / 2, 0},
+    {"1/3", 1.0f / 3, 0},
+    {"1/6", 1.0f / 6, 0},
+    {"1/8", 1.0f / 8, 0},
+    {"0.3", 0.3f, 0},
+    {"icon 0.05", 0.05f, 0},
+    {"0.3 rotated", 0.3f, 30},
+    {"2x", 2.0f, 0},
+};
+
+void usage() {
+    printf("usage: blit_bench [-s size] [--time ms]\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-s" && hasValue) {
+            opt.size = atoi(argv[++i]);
+        } else if (arg == "--time" && hasValue) {
+            opt.time = atof(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return opt.size > 0 && opt.time > 0;
+}
+
+// opaque rings and stripes, enough detail to alias when sampled sparsely
+VBitmap makeImage(int size) {
+    VBitmap image(size, size, VBitmap::Format::ARGB32_Premultiplied);
+    for (int y = 0; y < size; y++) {
+        uint32_t *row = reinterpret_cast<uint32_t *>(image.data() + image.stride() * y);
+        for (int x = 0; x < size; x++) {
+            double dx = x - size / 2.0, dy = y - size / 2.0;
+            uint32_t r = uint32_t(127.5 + 127.5 * sin(sqrt(dx * dx + dy * dy) * 0.15));
+            uint32_t g = uint32_t(x * 255 / size);
+            uint32_t b = ((x / 3 + y / 5) & 1) ? 230 : 20;
+            row[x] = 0xff000000 | (r << 16) | (g << 8) | b;
+        }
+    }
+    return image;
+}
+
+// whole target pixels only, so every one of them has source behind it
+int targetSize(const Options &opt, const Case &c) {
+    return std::max(1, int(opt.size * c.scale));
+}
+
+// scaled from the top left corner, rotated ones around the center
+VMatrix placement(const Options &opt, const Case &c, int target) {
+    VMatrix m;
+    if (c.angle) {
+        m.translate(target / 2.0f, target / 2.0f);
+        m.rotate(c.angle);
+        m.scale(c.scale, c.scale);
+        m.translate(-opt.size / 2.0f, -opt.size / 2.0f);
+    } else {
+        m.scale(c.scale, c.scale);
+    }
+    return m;
+}
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// megapixels per second, last draw is left in surface
+double draw(const Options &opt, const VTexture &texture, VBitmap &surface) {
+    const int size = int(surface.width());
+    VRle rle = VRle::toRle(VRect(0, 0, size, size));
+    VPainter painter(&surface);
+    painter.setBlendMode(BlendMode::Src);
+
+    size_t pixels = 0;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        painter.setBrush(VBrush(&texture));
+        painter.drawRle(VPoint(), rle);
+        pixels += size_t(size) * size;
+        elapsed = msSince(start);
+    } while (elapsed < opt.time);
+    return pixels / elapsed / 1000.0;
+}
+
+// largest channel difference from the exact average of the source area
+// behind every target pixel
+int areaError(const VBitmap &image, const VBitmap &surface, float scale) {
+    const int size = int(surface.width()), source = int(image.width());
+    const double step = 1.0 / scale;
+    int worst = 0;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            double sum[4] = {0, 0, 0, 0}, area = 0;
+            const double x0 = x * step, x1 = (x + 1) * step;
+            const double y0 = y * step, y1 = (y + 1) * step;
+            for (int sy = int(y0); sy < std::min(int(ceil(y1)), source); sy++) {
+                const double wy = std::min(y1, sy + 1.0) - std::max(y0, double(sy));
+                const uint32_t *row = reinterpret_cast<const uint32_t *>(image.data() + image.stride() * sy);
+                for (int sx = int(x0); sx < std::min(int(ceil(x1)), source); sx++) {
+                    const double w = wy * (std::min(x1, sx + 1.0) - std::max(x0, double(sx)));
+                    for (int c = 0; c < 4; c++) sum[c] += w * ((row[sx] >> (8 * c)) & 0xff);
+                    area += w;
+                }
+            }
+            const uint32_t p = reinterpret_cast<const uint32_t *>(surface.data() + surface.stride() * y)[x];
+            for (int c = 0; c < 4; c++) {
+                worst = std::max(worst, std::abs(int(std::lround(sum[c] / area)) - int((p >> (8 * c)) & 0xff)));
+            }
+        }
+    }
+    return worst;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    VTexture texture;
+    texture.mBitmap = makeImage(opt.size);
+
+    printf("%dx%d source, target megapixels per second, max channel error vs area average\n",
+           opt.size, opt.size);
+    printf("%-12s %7s %10s %10s %7s %7s\n", "scale", "target", "default", "smooth", "err", "err");
+    int result = 0, baseError = 0;
+    for (const Case &c : CASES) {
+        const int size = targetSize(opt, c);
+        VBitmap surface(size, size, VBitmap::Format::ARGB32_Premultiplied);
+        texture.mMatrix = placement(opt, c, size);
+        const bool axisAligned = !c.angle;
+
+        configureImageSmoothing(false);
+        const double plain = draw(opt, texture, surface);
+        const int plainError = axisAligned ? areaError(texture.mBitmap, surface, c.scale) : -1;
+
+        configureImageSmoothing(true);
+        const double smooth = draw(opt, texture, surface);
+        const int smoothError = axisAligned ? areaError(texture.mBitmap, surface, c.scale) : -1;
+
+        printf("%-12s %7d %10.1f %10.1f %7d %7d\n", c.name, size, plain, smooth, plainError,
+               smoothError);
+
+        // whole factor shrinks (up to 16) are box filtered, power of two ones
+        // also without smoothing, only rounding may differ. image spans never
+        // blend at full coverage, 1:1 copy shows how much that alone costs.
+        const float factor = 1 / c.scale;
+        const bool whole = axisAligned && factor > 1 && factor <= 16 && factor == std::round(factor);
+        const bool powerOfTwo = whole && (int(factor) & (int(factor) - 1)) == 0;
+        if (c.scale == 1) baseError = smoothError;
+        if (whole && smoothError > baseError + 1) {
+            printf("%s: box filtered image is off by %d\n", c.name, smoothError);
+            result = 1;
+        }
+        if (powerOfTwo && plainError > baseError + 1) {
+            printf("%s: mip level is off by %d\n", c.name, plainError);
+            result = 1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,139 @@
+/*
+ * Easing table test, builds the value table of many random bezier curves
+ * and sweeps each one against the curve solver. Fails when a kept table
+ * strays more than 2e-4 (VInterpolator::kLutTolerance) from the solver,
+ * when steep curves keep their table or when values outside 0..1 do not
+ * come from the solver.
+ *
+ * Build (any C++17 compiler), from ImmLottie folder:
+ *   g++ -std=c++17 -O2 -pthread -DIMLOTTIE_STANDALONE -ICore \
+ *       Core/imottie_renderer.cpp Core/freetype/v_ft_*.cpp Tools/easing_lut_test.cpp -o easing_lut_test
+ *
+ * Usage:
+ *   easing_lut_test [options]
+ *     -n <n>            random curves, default 20000
+ *     --steps <n>       sweep steps per curve, default 4096
+ *     --seed <n>        seed of the curves, default 1
+ */
+
+#include "imlottie_impl.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace imlottie;
+
+namespace {
+
+struct Options {
+    int curves = 20000;
+    int steps = 4096;
+    uint32_t seed = 1;
+};
+
+// same bound as VInterpolator::kLutTolerance
+const float TOLERANCE = 0.0002f;
+
+int failures = 0;
+
+void check(bool ok, const char *what) {
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+void usage() {
+    printf("usage: easing_lut_test [-n curves] [--steps n] [--seed n]\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-n" && hasValue) {
+            opt.curves = atoi(argv[++i]);
+        } else if (arg == "--steps" && hasValue) {
+            opt.steps = atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            opt.seed = uint32_t(strtoul(argv[++i], nullptr, 10));
+        } else {
+            return false;
+        }
+    }
+    return opt.curves > 0 && opt.steps > 0;
+}
+
+// 0..1 in steps of 1/4096
+float nextUnit(uint32_t &seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return float((seed >> 8) % 4097) / 4096.f;
+}
+
+// largest distance between table and solver over the sweep
+float sweepError(const VInterpolator &curve, int steps) {
+    float error = 0;
+    for (int i = 0; i <= steps; i++) {
+        const float x = float(i) / steps;
+        error = std::max(error, std::fabs(curve.value(x) - curve.exactValue(x)));
+    }
+    return error;
+}
+
+// control points as in lottie files, x within 0..1 and y overshooting
+void randomCurves(const Options &opt) {
+    uint32_t seed = opt.seed;
+    int tables = 0;
+    float worst = 0;
+    for (int i = 0; i < opt.curves; i++) {
+        const float x1 = nextUnit(seed), y1 = nextUnit(seed) * 2.f - 0.5f;
+        const float x2 = nextUnit(seed), y2 = nextUnit(seed) * 2.f - 0.5f;
+        VInterpolator curve(x1, y1, x2, y2);
+        if (!curve.buildLut()) {
+            check(!curve.hasLut(), "dropped table still used");
+            continue;
+        }
+        tables++;
+        const float error = sweepError(curve, opt.steps);
+        worst = std::max(worst, error);
+        if (error > TOLERANCE) {
+            check(false, "table strays from the solver");
+            return;
+        }
+        for (float x : {-0.25f, 1.25f}) {
+            check(curve.value(x) == curve.exactValue(x), "values outside 0..1 solve the curve");
+        }
+    }
+    printf("random curves: %d of %d got a table, worst error %.2e\n", tables, opt.curves, worst);
+}
+
+// curves close to a step keep solving, linear one needs no table
+void specialCurves() {
+    VInterpolator linear(0.f, 0.f, 1.f, 1.f);
+    check(!linear.buildLut() && linear.value(0.3f) == 0.3f, "linear curve without table");
+
+    for (float sharp : {0.9f, 0.95f, 1.f}) {
+        VInterpolator steep(sharp, 0.f, 1.f - sharp, 1.f);
+        check(!steep.buildLut(), "steep curve keeps no table");
+    }
+
+    VInterpolator ease(0.42f, 0.f, 0.58f, 1.f);
+    check(ease.buildLut(), "ease in out gets a table");
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    randomCurves(opt);
+    specialCurves();
+    printf(failures ? "easing table test failed\n" : "easing table test passed\n");
+    return failures ? 1 : 0;
+}
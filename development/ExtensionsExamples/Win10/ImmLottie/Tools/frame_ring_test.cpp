@@ -0,0 +1,195 @@
+/*
+ * Frame ring test, plays generated animations through the ImLottie render
+ * thread and atlas upload like ImGui frames would, with the UI stalling
+ * now and then, and counts heap allocations by replacing operator new.
+ * Fails when frames reach the main thread out of order or skipped, or
+ * when steady playback allocates on the main thread or in the frame
+ * handoff of the render side.
+ *
+ * Build (any C++17 compiler), from ImmLottie folder:
+ *   g++ -std=c++17 -O2 -pthread -DIMLOTTIE_STANDALONE -ICore -IGUI \
+ *       Core/imottie_renderer.cpp Core/freetype/v_ft_*.cpp Tools/frame_ring_test.cpp -o frame_ring_test
+ *
+ * Usage:
+ *   frame_ring_test [options] [file.json...]
+ *     --anims <n>       animations playing at once, default 12
+ *     --frames <n>      UI frames, default 400
+ *     --threads <n>     render workers, default 2
+ *   Without files a generated composition is played, its shapes do not
+ *   allocate in the rasterizer once warm, so any allocation is the ring's.
+ */
+
+#define DEBUG_LOTTIE_UPDATE 1
+#include "imgui_headless.h"
+#include "imlottie.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::atomic<size_t> mainAllocs{0};
+std::atomic<size_t> renderAllocs{0};
+thread_local bool onMainThread = false;
+
+struct Options {
+    int anims = 12;
+    int frames = 400;
+    int threads = 2;
+    std::vector<std::string> files;
+};
+
+void usage() {
+    printf("usage: frame_ring_test [--anims n] [--frames n] [--threads n] [file.json...]\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--anims" && hasValue) {
+            opt.anims = atoi(argv[++i]);
+        } else if (arg == "--frames" && hasValue) {
+            opt.frames = atoi(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            opt.threads = atoi(argv[++i]);
+        } else if (arg[0] != '-') {
+            opt.files.push_back(arg);
+        } else {
+            return false;
+        }
+    }
+    return opt.anims > 0 && opt.frames > 0;
+}
+
+// rotating square and a sliding circle, 60 frames at 60 fps
+std::string composition() {
+    return "{\"v\":\"5.5.2\",\"fr\":60,\"ip\":0,\"op\":60,\"w\":100,\"h\":100,\"nm\":\"ring\",\"ddd\":0,"
+           "\"assets\":[],\"layers\":[{\"ddd\":0,\"ind\":1,\"ty\":4,\"nm\":\"shapes\",\"sr\":1,\"ks\":{"
+           "\"o\":{\"a\":0,\"k\":100},\"r\":{\"a\":1,\"k\":[{\"i\":{\"x\":1,\"y\":1},\"o\":{\"x\":0,\"y\":0},"
+           "\"t\":0,\"s\":[0],\"e\":[90]},{\"t\":60}]},\"p\":{\"a\":0,\"k\":[50,50,0]},"
+           "\"a\":{\"a\":0,\"k\":[0,0,0]},\"s\":{\"a\":0,\"k\":[100,100,100]}},\"ao\":0,\"shapes\":["
+           "{\"ty\":\"gr\",\"it\":[{\"ty\":\"rc\",\"d\":1,\"s\":{\"a\":0,\"k\":[50,50]},\"p\":{\"a\":0,\"k\":[0,0]},"
+           "\"r\":{\"a\":0,\"k\":8}},{\"ty\":\"fl\",\"c\":{\"a\":0,\"k\":[0.2,0.5,1,1]},\"o\":{\"a\":0,\"k\":100},"
+           "\"r\":1},{\"ty\":\"tr\",\"p\":{\"a\":0,\"k\":[0,0]},\"a\":{\"a\":0,\"k\":[0,0]},"
+           "\"s\":{\"a\":0,\"k\":[100,100]},\"r\":{\"a\":0,\"k\":0},\"o\":{\"a\":0,\"k\":100}}]},"
+           "{\"ty\":\"gr\",\"it\":[{\"ty\":\"el\",\"d\":1,\"s\":{\"a\":0,\"k\":[20,20]},\"p\":{\"a\":1,\"k\":["
+           "{\"i\":{\"x\":1,\"y\":1},\"o\":{\"x\":0,\"y\":0},\"t\":0,\"s\":[-30,0],\"e\":[30,0]},{\"t\":60}]}},"
+           "{\"ty\":\"fl\",\"c\":{\"a\":0,\"k\":[1,0.6,0.1,1]},\"o\":{\"a\":0,\"k\":100},\"r\":1},"
+           "{\"ty\":\"tr\",\"p\":{\"a\":0,\"k\":[0,0]},\"a\":{\"a\":0,\"k\":[0,0]},\"s\":{\"a\":0,\"k\":[100,100]},"
+           "\"r\":{\"a\":0,\"k\":0},\"o\":{\"a\":0,\"k\":100}}]}],\"ip\":0,\"op\":60,\"st\":0,\"bm\":0}]}";
+}
+
+} // namespace
+
+#if defined(__GNUC__) && !defined(__clang__)
+// free() of memory from the replaced operator new is what it should be
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void *operator new(size_t size) {
+    (onMainThread ? mainAllocs : renderAllocs).fetch_add(1, std::memory_order_relaxed);
+    if (void *p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+    onMainThread = true;
+
+    std::string generated;
+    if (opt.files.empty()) {
+        generated = (std::filesystem::temp_directory_path() / "frame_ring_test.json").string();
+        std::ofstream(generated) << composition();
+        opt.files.push_back(generated);
+    }
+
+    ImLottie::init(opt.threads, 16, 0);
+    auto *renderer = ImLottie::detail::g_lottieRenderer;
+    std::vector<ImGuiID> pids;
+    for (int i = 0; i < opt.anims; i++) {
+        const int size = 64 + (i % 3) * 64;
+        pids.push_back(renderer->match(opt.files[i % opt.files.size()].c_str(), size, size, true, 60));
+    }
+
+    // frames of every animation must arrive one after another
+    std::map<ImGuiID, int> lastFrame;
+    size_t frames = 0, skipped = 0, steadyFrames = 0, mainBase = 0, renderBase = 0;
+    const int warmup = opt.frames / 4;
+    for (int ui = 0; ui < opt.frames; ui++) {
+        if (ui == warmup) {
+            mainBase = mainAllocs.load();
+            renderBase = renderAllocs.load();
+            steadyFrames = frames;
+        }
+
+        for (ImGuiID pid : pids) {
+            renderer->render(pid);
+        }
+        {
+            std::lock_guard<std::mutex> lock(renderer->animationsPresentMutex);
+            for (auto &it : renderer->animationsPresent) {
+                const auto &ring = *it.second.frames;
+                for (size_t i = 0; i < ring.readable(); i++) {
+                    const int frame = ring.at(i).frame;
+                    auto last = lastFrame.find(it.first);
+                    if (last != lastFrame.end() && frame != last->second + 1 && frame != 0) {
+                        skipped++;
+                    }
+                    lastFrame[it.first] = frame;
+                    frames++;
+                }
+            }
+        }
+        ImLottie::sync();
+
+        // UI stalls every tenth frame, rings fill up meanwhile
+        std::this_thread::sleep_for(std::chrono::milliseconds(ui % 10 == 0 ? 120 : 4));
+    }
+
+    const size_t mainSteady = mainAllocs.load() - mainBase;
+    const size_t renderSteady = renderAllocs.load() - renderBase;
+    steadyFrames = frames - steadyFrames;
+    ImLottie::destroy();
+    if (!generated.empty()) {
+        std::filesystem::remove(generated);
+    }
+
+    printf("%zu frames (%zu steady), %zu skipped or out of order\n", frames, steadyFrames, skipped);
+    printf("steady allocations: main thread %zu, render side %zu (%.2f per frame)\n", mainSteady, renderSteady,
+           steadyFrames ? double(renderSteady) / steadyFrames : 0.0);
+
+    int result = 0;
+    if (!frames || skipped) {
+        printf("frames were lost between render thread and main thread\n");
+        result = 1;
+    }
+    if (mainSteady) {
+        printf("main thread allocates in steady playback\n");
+        result = 1;
+    }
+    // files of the command line may allocate in the rasterizer itself
+    if (!generated.empty() && renderSteady) {
+        printf("render side allocates in steady playback\n");
+        result = 1;
+    }
+    return result;
+}
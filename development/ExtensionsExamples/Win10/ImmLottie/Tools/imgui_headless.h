@@ -0,0 +1,40 @@
+/*
+ * Just enough of ImGui for tools that drive ImLottie without a window or
+ * gpu: widgets are never added and the clock is steady_clock. Include it
+ * before imlottie.h from the single source file of a tool.
+ */
+
+#pragma once
+
+#ifndef IMGUI_API
+#define IMGUI_API
+#endif
+#include "imgui.h"
+#include "imgui_internal.h"
+
+#include <chrono>
+
+ImGuiID ImHashStr(const char *data, size_t, ImGuiID seed) {
+    // FNV-1a, tools only need distinct ids for distinct strings
+    ImGuiID hash = seed ^ 2166136261u;
+    while (*data) {
+        hash = (hash ^ (unsigned char)*data++) * 16777619u;
+    }
+    return hash;
+}
+
+ImGuiID ImGuiWindow::GetID(const char *, const char *) { return 0; }
+void ImDrawList::AddImage(ImTextureID, const ImVec2 &, const ImVec2 &, const ImVec2 &, const ImVec2 &, ImU32) {}
+void ImDrawList::AddRectFilled(const ImVec2 &, const ImVec2 &, ImU32, float, ImDrawFlags) {}
+
+namespace ImGui {
+double GetTime() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+ImGuiWindow *GetCurrentWindow() { return nullptr; }
+ImGuiContext *GetCurrentContext() { return nullptr; }
+void ItemSize(const ImVec2 &, float) {}
+bool ItemAdd(const ImRect &, ImGuiID, const ImRect *, ImGuiItemFlags) { return false; }
+ImU32 GetColorU32(const ImVec4 &) { return 0; }
+} // namespace ImGui
@@ -0,0 +1,161 @@
+/*
+ * Keyframe lookup benchmark, builds a float property with many keyframes
+ * (some with gaps between them) and times LOTAnimInfo::value() for frames
+ * in playback order and in random order, next to the linear scan over all
+ * keyframes that lookups used before. Fails when any frame gets another
+ * value than the scan gives.
+ *
+ * Build (any C++17 compiler), from ImmLottie folder:
+ *   g++ -std=c++17 -O2 -pthread -DIMLOTTIE_STANDALONE -ICore \
+ *       Core/imottie_renderer.cpp Core/freetype/v_ft_*.cpp Tools/keyframe_bench.cpp -o keyframe_bench
+ *
+ * Usage:
+ *   keyframe_bench [options]
+ *     --keyframes <n>   keyframes of the property, default 1000
+ *     --rounds <n>      passes over all frames per timing, default 200
+ *     --seed <n>        seed of keyframe lengths and values, default 1
+ */
+
+#include "imlottie_impl.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace imlottie;
+
+namespace {
+
+struct Options {
+    int keyframes = 1000;
+    int rounds = 200;
+    uint32_t seed = 1;
+};
+
+void usage() {
+    printf("usage: keyframe_bench [--keyframes n] [--rounds n] [--seed n]\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--keyframes" && hasValue) {
+            opt.keyframes = atoi(argv[++i]);
+        } else if (arg == "--rounds" && hasValue) {
+            opt.rounds = atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            opt.seed = uint32_t(strtoul(argv[++i], nullptr, 10));
+        } else {
+            return false;
+        }
+    }
+    return opt.keyframes > 0 && opt.rounds > 0;
+}
+
+uint32_t nextRandom(uint32_t &seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+// lookup as it was before LOTAnimInfo::segment()
+float linearValue(const LOTAnimInfo<float> &info, int frameNo) {
+    const auto &keyFrames = info.mKeyFrames;
+    if (keyFrames.front().mStartFrame >= frameNo)
+        return keyFrames.front().mValue.mStartValue;
+    if (keyFrames.back().mEndFrame <= frameNo)
+        return keyFrames.back().mValue.mEndValue;
+
+    for (const auto &keyFrame : keyFrames) {
+        if (frameNo >= keyFrame.mStartFrame && frameNo < keyFrame.mEndFrame)
+            return keyFrame.value(frameNo);
+    }
+    return 0;
+}
+
+// ns per lookup of frames, taken rounds times
+template <typename Lookup>
+double timeLookups(const std::vector<int> &frames, int rounds, Lookup lookup, double &sink) {
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (int frame : frames) {
+            sink += lookup(frame);
+        }
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (double(frames.size()) * rounds);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    // few easing curves shared by keyframes, like the parser does
+    std::vector<VInterpolator> curves = {{0.f, 0.f, 1.f, 1.f}, {0.42f, 0.f, 0.58f, 1.f},
+                                         {0.33f, 0.f, 0.67f, 1.f}, {0.25f, 0.1f, 0.25f, 1.f}};
+    for (auto &curve : curves) {
+        curve.buildLut();
+    }
+
+    LOTAnimInfo<float> info;
+    uint32_t seed = opt.seed;
+    int frame = 0;
+    float value = 0;
+    for (int i = 0; i < opt.keyframes; i++) {
+        LOTKeyFrame<float> keyFrame;
+        keyFrame.mStartFrame = float(frame);
+        frame += 1 + int(nextRandom(seed) % 4);
+        keyFrame.mEndFrame = float(frame);
+        keyFrame.mInterpolator = &curves[nextRandom(seed) % curves.size()];
+        keyFrame.mValue.mStartValue = value;
+        value = float(nextRandom(seed) % 1000);
+        keyFrame.mValue.mEndValue = value;
+        info.mKeyFrames.push_back(keyFrame);
+        // hold frames between some keyframes
+        if (nextRandom(seed) % 20 == 0) {
+            frame++;
+        }
+    }
+
+    std::vector<int> sequential, shuffled;
+    for (int f = -2; f < frame + 2; f++) {
+        sequential.push_back(f);
+    }
+    shuffled = sequential;
+    for (size_t i = shuffled.size() - 1; i > 0; i--) {
+        std::swap(shuffled[i], shuffled[nextRandom(seed) % (i + 1)]);
+    }
+
+    size_t mismatches = 0;
+    for (int f : shuffled) {
+        mismatches += info.value(f) != linearValue(info, f);
+    }
+    for (int f : sequential) {
+        mismatches += info.value(f) != linearValue(info, f);
+    }
+
+    double sink = 0;
+    auto segment = [&info] (int f) { return info.value(f); };
+    auto scan = [&info] (int f) { return linearValue(info, f); };
+    const double segmentSeq = timeLookups(sequential, opt.rounds, segment, sink);
+    const double segmentRand = timeLookups(shuffled, opt.rounds, segment, sink);
+    const double scanSeq = timeLookups(sequential, opt.rounds, scan, sink);
+    const double scanRand = timeLookups(shuffled, opt.rounds, scan, sink);
+
+    printf("%d keyframes over %d frames, %zu lookups per timing (checksum %.0f)\n", opt.keyframes, frame,
+           sequential.size() * opt.rounds, sink);
+    printf("%-12s sequential %8.1f ns, random %8.1f ns per lookup\n", "segment", segmentSeq, segmentRand);
+    printf("%-12s sequential %8.1f ns, random %8.1f ns per lookup\n", "linear scan", scanSeq, scanRand);
+    if (mismatches) {
+        printf("FAILED: %zu frames differ from the linear scan\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
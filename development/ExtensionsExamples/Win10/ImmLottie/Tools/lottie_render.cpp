@@ -0,0 +1,370 @@
+/*
+ * Headless lottie renderer, runs the ImLottie rasterizer outside ImMobile
+ * to measure it and to catch rendering regressions.
+ *
+ * Build (any C++17 compiler), from ImmLottie folder:
+ *   g++ -std=c++17 -O2 -pthread -DIMLOTTIE_STANDALONE -ICore \
+ *       Core/imottie_renderer.cpp Core/freetype/v_ft_*.cpp Tools/lottie_render.cpp -o lottie_render
+ *
+ * Usage:
+ *   lottie_render <file.json> [options]
+ *     -s <w>[x<h>]      canvas size, default 256
+ *     -f <first>[:<last>] frame range, default whole animation
+ *     -o <dir>          write frames to dir as frame_NNNN.png (or .argb with --raw)
+ *     --raw             write premultiplied ARGB32 as it is in memory, no header
+ *     --partial         render every frame over previous one like ImLottie does
+ *     --threads <n>     raster threads, 0 rasterizes on main thread (default)
+ *     --compare <dir>   compare frames with frame_NNNN.png in dir, exit code 1 on mismatch
+ *     --tolerance <n>   max channel difference still counted as match, default 2
+ *     --quiet           print only summary
+ *     --trace <file>    write Chrome trace json of pipeline stages, needs -DIMLOTTIE_TRACE
+ *
+ * To make reference images for --compare render known good build with -o.
+ */
+
+#include "imlottie_impl.h"
+#include "stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string path;
+    int width = 256;
+    int height = 256;
+    int first = 0;
+    int last = -1;
+    std::string outDir;
+    bool raw = false;
+    bool partial = false;
+    int threads = 0;
+    std::string compareDir;
+    int tolerance = 2;
+    bool quiet = false;
+    std::string tracePath;
+};
+
+struct StageStats {
+    double total = 0;
+    double min = 1e9;
+    double max = 0;
+
+    void add(double ms) {
+        total += ms;
+        min = std::min(min, ms);
+        max = std::max(max, ms);
+    }
+};
+
+void usage() {
+    printf("usage: lottie_render <file.json> [-s w[xh]] [-f first[:last]] [-o dir] [--raw] [--partial]\n"
+           "                     [--threads n] [--compare dir] [--tolerance n] [--quiet]\n"
+           "                     [--trace file.json]\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-s" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &opt.width, &opt.height) == 1) {
+                opt.height = opt.width;
+            }
+        } else if (arg == "-f" && hasValue) {
+            if (sscanf(argv[++i], "%d:%d", &opt.first, &opt.last) == 1) {
+                opt.last = opt.first;
+            }
+        } else if (arg == "-o" && hasValue) {
+            opt.outDir = argv[++i];
+        } else if (arg == "--raw") {
+            opt.raw = true;
+        } else if (arg == "--partial") {
+            opt.partial = true;
+        } else if (arg == "--threads" && hasValue) {
+            opt.threads = atoi(argv[++i]);
+        } else if (arg == "--compare" && hasValue) {
+            opt.compareDir = argv[++i];
+        } else if (arg == "--tolerance" && hasValue) {
+            opt.tolerance = atoi(argv[++i]);
+        } else if (arg == "--quiet") {
+            opt.quiet = true;
+        } else if (arg == "--trace" && hasValue) {
+            opt.tracePath = argv[++i];
+        } else if (arg[0] != '-' && opt.path.empty()) {
+            opt.path = arg;
+        } else {
+            return false;
+        }
+    }
+    return !opt.path.empty() && opt.width > 0 && opt.height > 0;
+}
+
+// premultiplied ARGB32 (as uint32 in memory) to straight RGBA bytes
+void toRGBA(const std::vector<uint32_t> &argb, std::vector<uint8_t> &rgba) {
+    rgba.resize(argb.size() * 4);
+    for (size_t i = 0; i < argb.size(); i++) {
+        uint32_t p = argb[i];
+        uint32_t a = p >> 24;
+        uint32_t r = (p >> 16) & 0xff, g = (p >> 8) & 0xff, b = p & 0xff;
+        if (a && a != 255) {
+            r = std::min<uint32_t>(255, (r * 255 + a / 2) / a);
+            g = std::min<uint32_t>(255, (g * 255 + a / 2) / a);
+            b = std::min<uint32_t>(255, (b * 255 + a / 2) / a);
+        }
+        rgba[i * 4 + 0] = uint8_t(r);
+        rgba[i * 4 + 1] = uint8_t(g);
+        rgba[i * 4 + 2] = uint8_t(b);
+        rgba[i * 4 + 3] = uint8_t(a);
+    }
+}
+
+uint32_t crc32(const uint8_t *data, size_t size, uint32_t crc = 0) {
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+void putBE32(std::vector<uint8_t> &out, uint32_t v) {
+    out.push_back(uint8_t(v >> 24));
+    out.push_back(uint8_t(v >> 16));
+    out.push_back(uint8_t(v >> 8));
+    out.push_back(uint8_t(v));
+}
+
+void putChunk(FILE *f, const char *type, const std::vector<uint8_t> &data) {
+    std::vector<uint8_t> chunk;
+    putBE32(chunk, uint32_t(data.size()));
+    chunk.insert(chunk.end(), type, type + 4);
+    chunk.insert(chunk.end(), data.begin(), data.end());
+    putBE32(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+    fwrite(chunk.data(), 1, chunk.size(), f);
+}
+
+// RGBA png with stored (not compressed) deflate blocks, enough for goldens
+bool writePNG(const std::string &path, const std::vector<uint8_t> &rgba, int w, int h) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    fwrite(signature, 1, sizeof(signature), f);
+
+    std::vector<uint8_t> ihdr;
+    putBE32(ihdr, uint32_t(w));
+    putBE32(ihdr, uint32_t(h));
+    ihdr.insert(ihdr.end(), {8, 6, 0, 0, 0}); // 8 bit RGBA, no interlace
+    putChunk(f, "IHDR", ihdr);
+
+    // every row starts with filter type 0
+    std::vector<uint8_t> scanlines;
+    scanlines.reserve(size_t(h) * (w * 4 + 1));
+    for (int y = 0; y < h; y++) {
+        scanlines.push_back(0);
+        scanlines.insert(scanlines.end(), rgba.begin() + size_t(y) * w * 4, rgba.begin() + size_t(y + 1) * w * 4);
+    }
+
+    std::vector<uint8_t> zlib = {0x78, 0x01};
+    uint32_t s1 = 1, s2 = 0;
+    for (size_t pos = 0; pos < scanlines.size() || pos == 0;) {
+        size_t len = std::min<size_t>(65535, scanlines.size() - pos);
+        bool final = pos + len == scanlines.size();
+        zlib.push_back(final ? 1 : 0);
+        zlib.push_back(uint8_t(len));
+        zlib.push_back(uint8_t(len >> 8));
+        zlib.push_back(uint8_t(~len));
+        zlib.push_back(uint8_t(~len >> 8));
+        for (size_t i = 0; i < len; i++) {
+            uint8_t c = scanlines[pos + i];
+            zlib.push_back(c);
+            s1 = (s1 + c) % 65521;
+            s2 = (s2 + s1) % 65521;
+        }
+        pos += len;
+        if (final) {
+            break;
+        }
+    }
+    putBE32(zlib, (s2 << 16) | s1);
+    putChunk(f, "IDAT", zlib);
+    putChunk(f, "IEND", {});
+
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
+
+bool writeRaw(const std::string &path, const std::vector<uint32_t> &argb) {
+    FILE *f = fopen(path.c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    fwrite(argb.data(), sizeof(uint32_t), argb.size(), f);
+    bool ok = ferror(f) == 0;
+    fclose(f);
+    return ok;
+}
+
+// largest channel difference against golden png, -1 when it can't be read
+int compareWithGolden(const std::string &path, const std::vector<uint8_t> &rgba, int w, int h, size_t &differing, int tolerance) {
+    int gw = 0, gh = 0, channels = 0;
+    uint8_t *golden = stbi_load(path.c_str(), &gw, &gh, &channels, 4);
+    if (!golden) {
+        return -1;
+    }
+    if (gw != w || gh != h) {
+        stbi_image_free(golden);
+        return -1;
+    }
+
+    int worst = 0;
+    differing = 0;
+    for (size_t i = 0; i < size_t(w) * h; i++) {
+        int pixelWorst = 0;
+        for (int c = 0; c < 4; c++) {
+            pixelWorst = std::max(pixelWorst, std::abs(int(golden[i * 4 + c]) - int(rgba[i * 4 + c])));
+        }
+        if (pixelWorst > tolerance) {
+            differing++;
+        }
+        worst = std::max(worst, pixelWorst);
+    }
+    stbi_image_free(golden);
+    return worst;
+}
+
+std::string frameName(const std::string &dir, int frame, const char *ext) {
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%04d.%s", frame, ext);
+    return dir + "/" + name;
+}
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    imlottie::configureRasterThreads(opt.threads);
+    // every run parses the file, nothing to share
+    imlottie::configureModelCacheSize(0);
+
+    auto parseStart = std::chrono::steady_clock::now();
+    auto anim = imlottie::Animation::loadFromFile(opt.path, false);
+    double parseMs = msSince(parseStart);
+    if (!anim) {
+        fprintf(stderr, "can't load %s\n", opt.path.c_str());
+        return 2;
+    }
+
+    const int total = int(anim->totalFrame());
+    int first = std::max(0, opt.first);
+    int last = opt.last < 0 ? total - 1 : std::min(opt.last, total - 1);
+    printf("%s: %d frames, %.2f fps, parse %.3f ms\n", opt.path.c_str(), total, anim->frameRate(), parseMs);
+
+    std::vector<uint32_t> argb(size_t(opt.width) * opt.height, 0);
+    std::vector<uint8_t> rgba;
+    StageStats update, rasterize, blend, frameTotal;
+    int mismatched = 0;
+    int rendered = 0;
+
+    for (int frame = first; frame <= last; frame++) {
+        imlottie::Surface surface(argb.data(), opt.width, opt.height, opt.width * sizeof(uint32_t));
+        surface.setPartialUpdate(opt.partial);
+
+        auto start = std::chrono::steady_clock::now();
+        anim->renderSync(frame, surface);
+        double ms = msSince(start);
+        rendered++;
+
+        const imlottie::RenderTimings &t = anim->renderTimings();
+        update.add(t.update);
+        rasterize.add(t.rasterize);
+        blend.add(t.blend);
+        frameTotal.add(ms);
+        if (!opt.quiet) {
+            printf("frame %4d: update %.3f ms, rasterize %.3f ms, blend %.3f ms, total %.3f ms\n", frame, t.update, t.rasterize, t.blend, ms);
+        }
+
+        if (!opt.outDir.empty() || !opt.compareDir.empty()) {
+            toRGBA(argb, rgba);
+        }
+
+        if (!opt.outDir.empty()) {
+            bool ok = opt.raw ? writeRaw(frameName(opt.outDir, frame, "argb"), argb)
+                              : writePNG(frameName(opt.outDir, frame, "png"), rgba, opt.width, opt.height);
+            if (!ok) {
+                fprintf(stderr, "can't write frame %d to %s\n", frame, opt.outDir.c_str());
+                return 2;
+            }
+        }
+
+        if (!opt.compareDir.empty()) {
+            size_t differing = 0;
+            int worst = compareWithGolden(frameName(opt.compareDir, frame, "png"), rgba, opt.width, opt.height, differing, opt.tolerance);
+            if (worst < 0) {
+                printf("frame %4d: no golden image\n", frame);
+                mismatched++;
+            } else if (differing) {
+                printf("frame %4d: %zu pixels differ, max difference %d\n", frame, differing, worst);
+                mismatched++;
+            }
+        }
+    }
+
+    if (rendered) {
+        auto print = [rendered] (const char *name, const StageStats &s) {
+            printf("%-10s avg %.3f ms, min %.3f ms, max %.3f ms\n", name, s.total / rendered, s.min, s.max);
+        };
+        print("update", update);
+        print("rasterize", rasterize);
+        print("blend", blend);
+        print("total", frameTotal);
+
+        size_t hits = 0, misses = 0, builds = 0;
+        imlottie::gradientCacheStats(hits, misses, builds);
+        if (hits || misses) {
+            printf("gradients  %zu hits, %zu misses, %zu tables built\n", hits, misses, builds);
+        }
+    }
+
+    const std::string trace = imlottie::traceSummary();
+    if (!trace.empty()) {
+        printf("%s", trace.c_str());
+    }
+    if (!opt.tracePath.empty() && !imlottie::traceExport(opt.tracePath)) {
+        fprintf(stderr, "can't write trace to %s (built without IMLOTTIE_TRACE?)\n", opt.tracePath.c_str());
+    }
+
+    if (!opt.compareDir.empty()) {
+        printf("%d of %d frames differ from %s\n", mismatched, rendered, opt.compareDir.c_str());
+        return mismatched ? 1 : 0;
+    }
+    return 0;
+}
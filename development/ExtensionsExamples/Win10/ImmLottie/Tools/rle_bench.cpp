@@ -0,0 +1,224 @@
+/*
+ * Mask heavy benchmark, renders a generated composition where every layer
+ * is cut by animated masks of all modes (and a clipped precomp), once with
+ * rle operations on the rendering thread and once split in row bands.
+ *
+ * Build (any C++17 compiler), from ImmLottie folder:
+ *   g++ -std=c++17 -O2 -pthread -DIMLOTTIE_STANDALONE -ICore \
+ *       Core/imottie_renderer.cpp Core/freetype/v_ft_*.cpp Tools/rle_bench.cpp -o rle_bench
+ *
+ * Usage:
+ *   rle_bench [options]
+ *     -s <w>[x<h>]      canvas size, default 1024
+ *     --layers <n>      masked layers, default 12
+ *     --points <n>      points of every mask star, default 48
+ *     --threads <n>     raster threads, default picks from cpu count
+ *     --bands <n>       spans per band for the banded run, default 4096
+ *     --dump <file>     write the composition json, to render it with
+ *                       lottie_render of another build
+ */
+
+#include "imlottie_impl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int width = 1024;
+    int height = 1024;
+    int layers = 12;
+    int points = 48;
+    int threads = -1;
+    size_t bands = 4096;
+    std::string dumpPath;
+};
+
+const int FRAMES = 60;
+
+void usage() {
+    printf("usage: rle_bench [-s w[xh]] [--layers n] [--points n] [--threads n] [--bands n]\n"
+           "                 [--dump file.json]\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-s" && hasValue) {
+            if (sscanf(argv[++i], "%dx%d", &opt.width, &opt.height) == 1) {
+                opt.height = opt.width;
+            }
+        } else if (arg == "--layers" && hasValue) {
+            opt.layers = atoi(argv[++i]);
+        } else if (arg == "--points" && hasValue) {
+            opt.points = atoi(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            opt.threads = atoi(argv[++i]);
+        } else if (arg == "--bands" && hasValue) {
+            opt.bands = size_t(atoll(argv[++i]));
+        } else if (arg == "--dump" && hasValue) {
+            opt.dumpPath = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return opt.width > 0 && opt.height > 0 && opt.layers > 0 && opt.points >= 3;
+}
+
+// closed star path around (cx, cy) turned by angle, as lottie shape json
+std::string star(double cx, double cy, double radius, int points, double angle) {
+    std::string v, zero;
+    char pt[64];
+    for (int i = 0; i < points * 2; i++) {
+        double r = (i & 1) ? radius * 0.55 : radius;
+        double a = angle + M_PI * i / points;
+        snprintf(pt, sizeof(pt), "%s[%.2f,%.2f]", i ? "," : "", cx + r * cos(a), cy + r * sin(a));
+        v += pt;
+        zero += i ? ",[0,0]" : "[0,0]";
+    }
+    return "{\"i\":[" + zero + "],\"o\":[" + zero + "],\"v\":[" + v + "],\"c\":true}";
+}
+
+// mask star turning half a point over the animation
+std::string mask(const char *mode, double cx, double cy, double radius, int points, double phase) {
+    const double turn = M_PI / points;
+    char key[64];
+    snprintf(key, sizeof(key), "{\"t\":%d,\"s\":[", FRAMES - 1);
+    return std::string("{\"mode\":\"") + mode + "\",\"inv\":false,\"o\":{\"a\":0,\"k\":100},\"pt\":{\"a\":1,\"k\":["
+           "{\"i\":{\"x\":0.5,\"y\":0.5},\"o\":{\"x\":0.5,\"y\":0.5},\"t\":0,\"s\":[" +
+           star(cx, cy, radius, points, phase) + "]}," + key + star(cx, cy, radius, points, phase + turn) + "]}]}}";
+}
+
+std::string solid(int index, const char *color, int w, int h, const std::string &masks, const char *parentKeys) {
+    char head[256];
+    snprintf(head, sizeof(head),
+             "{\"ddd\":0,\"ind\":%d,\"ty\":1,\"sc\":\"%s\",\"sw\":%d,\"sh\":%d,\"ip\":0,\"op\":%d,\"st\":0,"
+             "\"ks\":{\"o\":{\"a\":0,\"k\":70},\"r\":{\"a\":0,\"k\":0},\"p\":{\"a\":0,\"k\":[0,0,0]},"
+             "\"a\":{\"a\":0,\"k\":[0,0,0]},\"s\":{\"a\":0,\"k\":[100,100,100]}}%s,",
+             index, color, w, h, FRAMES, parentKeys);
+    return head + std::string("\"hasMask\":true,\"masksProperties\":[") + masks + "]}";
+}
+
+std::string composition(const Options &opt) {
+    static const char *colors[] = {"#e04040", "#40a0e0", "#60c060", "#e0c040", "#a060e0", "#40d0c0"};
+    static const char *modes[] = {"a", "s", "i", "f"};
+    const int w = opt.width, h = opt.height;
+    const double radius = std::min(w, h) * 0.3;
+
+    std::string layers;
+    for (int l = 0; l < opt.layers; l++) {
+        std::string masks;
+        for (int m = 0; m < 4; m++) {
+            double cx = w * (0.3 + 0.4 * ((l + m) % 3) / 2.0);
+            double cy = h * (0.3 + 0.4 * ((l * 3 + m) % 4) / 3.0);
+            masks += (m ? "," : "") + mask(modes[m], cx, cy, radius * (1.0 - 0.1 * m), opt.points, l * 0.37 + m);
+        }
+        layers += solid(l + 2, colors[l % 6], w, h, masks, "") + ",";
+    }
+
+    // precomp smaller than the composition, so its content goes through the clipper
+    std::string inner = solid(1, "#ffffff", w, h, mask("a", w / 2.0, h / 2.0, radius * 1.5, opt.points, 0), "");
+    char precomp[512];
+    snprintf(precomp, sizeof(precomp),
+             "{\"ddd\":0,\"ind\":1,\"ty\":0,\"refId\":\"inner\",\"w\":%d,\"h\":%d,\"ip\":0,\"op\":%d,\"st\":0,"
+             "\"ks\":{\"o\":{\"a\":0,\"k\":100},\"r\":{\"a\":0,\"k\":0},\"p\":{\"a\":0,\"k\":[%d,%d,0]},"
+             "\"a\":{\"a\":0,\"k\":[0,0,0]},\"s\":{\"a\":0,\"k\":[100,100,100]}},",
+             w * 3 / 4, h * 3 / 4, FRAMES, w / 8, h / 8);
+    layers += precomp + std::string("\"hasMask\":true,\"masksProperties\":[") +
+              mask("i", w * 0.375, h * 0.375, radius * 1.2, opt.points, 0.5) + "]}";
+
+    char head[160];
+    snprintf(head, sizeof(head), "{\"v\":\"5.5.2\",\"fr\":30,\"ip\":0,\"op\":%d,\"w\":%d,\"h\":%d,\"ddd\":0,", FRAMES, w, h);
+    return head + std::string("\"assets\":[{\"id\":\"inner\",\"layers\":[") + inner + "]}],\"layers\":[" + layers + "]}";
+}
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// average ms per frame, last frame is left in argb
+double run(const std::string &json, const Options &opt, std::vector<uint32_t> &argb, std::vector<uint32_t> &sums) {
+    auto anim = imlottie::Animation::loadFromData(json, "rle_bench", "", false);
+    if (!anim) {
+        return -1;
+    }
+
+    sums.clear();
+    double total = 0;
+    for (int frame = 0; frame < FRAMES; frame++) {
+        std::fill(argb.begin(), argb.end(), 0);
+        imlottie::Surface surface(argb.data(), opt.width, opt.height, opt.width * sizeof(uint32_t));
+        auto start = std::chrono::steady_clock::now();
+        anim->renderSync(frame, surface);
+        total += msSince(start);
+
+        uint32_t sum = 0;
+        for (uint32_t p : argb) {
+            sum = sum * 31 + p;
+        }
+        sums.push_back(sum);
+    }
+    return total / FRAMES;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    const std::string json = composition(opt);
+    if (!opt.dumpPath.empty()) {
+        FILE *f = fopen(opt.dumpPath.c_str(), "wb");
+        if (!f) {
+            fprintf(stderr, "can't write %s\n", opt.dumpPath.c_str());
+            return 2;
+        }
+        fwrite(json.data(), 1, json.size(), f);
+        fclose(f);
+    }
+
+    imlottie::configureRasterThreads(opt.threads);
+    imlottie::configureModelCacheSize(0);
+
+    std::vector<uint32_t> argb(size_t(opt.width) * opt.height);
+    std::vector<uint32_t> sequentialSums, bandedSums;
+
+    // first run warms up threads and scratch buffers
+    imlottie::configureRleBands(0);
+    run(json, opt, argb, sequentialSums);
+    double sequential = run(json, opt, argb, sequentialSums);
+
+    imlottie::configureRleBands(opt.bands);
+    double banded = run(json, opt, argb, bandedSums);
+    if (sequential < 0 || banded < 0) {
+        fprintf(stderr, "can't load generated composition\n");
+        return 2;
+    }
+
+    printf("%dx%d, %d layers x 4 masks of %d point stars, %d frames\n", opt.width, opt.height, opt.layers, opt.points, FRAMES);
+    printf("sequential rle ops   %8.3f ms/frame\n", sequential);
+    printf("banded (%zu spans) %8.3f ms/frame, %.2fx\n", opt.bands, banded, sequential / banded);
+
+    const std::string trace = imlottie::traceSummary();
+    if (!trace.empty()) {
+        printf("%s", trace.c_str());
+    }
+
+    if (sequentialSums != bandedSums) {
+        printf("banded frames differ from sequential ones\n");
+        return 1;
+    }
+    return 0;
+}
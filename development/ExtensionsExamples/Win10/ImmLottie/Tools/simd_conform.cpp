@@ -0,0 +1,378 @@
+/*
+ * SIMD conformance check, runs the SSE2 / NEON kernels of this build next
+ * to their scalar reference on lengths that exercise both the vector body
+ * and the scalar tail, prints every check and exits with 1 on mismatch.
+ * Everything must match exactly except radial gradients, whose vector
+ * lanes may land one color table entry away (up to 2 per channel), and
+ * NEON luma mattes, where fused multiply-add may move alpha by 1.
+ *
+ * The kernels are internal to the renderer, so this file includes the
+ * renderer source instead of linking it, IMLOTTIE_CONFORM keeps the
+ * scalar references that vector builds leave out.
+ *
+ * Build (any C++17 compiler), from ImmLottie folder:
+ *   g++ -std=c++17 -O2 -pthread -DIMLOTTIE_STANDALONE -ICore \
+ *       Core/freetype/v_ft_*.cpp Tools/simd_conform.cpp -o simd_conform
+ *
+ * Usage:
+ *   simd_conform
+ */
+
+#define IMLOTTIE_CONFORM
+#include "imottie_renderer.cpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace imlottie;
+
+namespace {
+
+constexpr int kLength = 67;
+
+int failures = 0;
+
+void report(const char *check, bool ok)
+{
+    printf("%-24s %s\n", check, ok ? "ok" : "FAILED");
+    if (!ok) failures++;
+}
+
+uint32_t nextRandom(uint32_t &seed)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed;
+}
+
+// blend modes against COMP_functionForMode_C, with a few fully opaque and
+// transparent premultiplied pixels and the constant alphas that have their
+// own shortcuts
+bool blendFunctionsConform()
+{
+    uint32_t src[kLength], ref[kLength], out[kLength];
+    uint32_t seed = 0x12345678;
+    for (int i = 0; i < kLength; i++) {
+        uint32_t a = (i % 7 == 0) ? 0 : (i % 5 == 0) ? 255 : nextRandom(seed) >> 24;
+        uint32_t r = (nextRandom(seed) >> 24) * a / 255, g = (nextRandom(seed) >> 24) * a / 255,
+                 b = (nextRandom(seed) >> 24) * a / 255;
+        src[i] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+    const uint32_t alphas[] = {0, 1, 128, 254, 255};
+    for (int mode = 0; mode < 4; mode++) {
+        for (uint32_t ca : alphas) {
+            for (int len : {kLength, 3, 8}) {
+                for (int i = 0; i < kLength; i++) ref[i] = out[i] = src[kLength - 1 - i];
+                COMP_functionForMode_C[mode](ref, src, len, ca);
+                functionForMode[mode](out, src, len, ca);
+                if (memcmp(ref, out, sizeof(ref))) {
+                    printf("  mode %d, alpha %u, length %d\n", mode, ca, len);
+                    return false;
+                }
+
+                for (int i = 0; i < kLength; i++) ref[i] = out[i] = src[kLength - 1 - i];
+                COMP_functionForModeSolid_C[mode](ref, len, src[len - 1], ca);
+                functionForModeSolid[mode](out, len, src[len - 1], ca);
+                if (memcmp(ref, out, sizeof(ref))) {
+                    printf("  solid mode %d, alpha %u, length %d\n", mode, ca, len);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool memfillConforms()
+{
+    uint32_t ref[kLength], out[kLength];
+    for (int len : {0, 1, 5, 17, kLength}) {
+        for (int i = 0; i < kLength; i++) ref[i] = out[i] = 0;
+        memfill32_C(ref + 1, 0xdeadbeef, len - 1);
+        memfill32(out + 1, 0xdeadbeef, len - 1);
+        if (memcmp(ref, out, sizeof(ref))) {
+            printf("  length %d\n", len - 1);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Gradient fetchers. Table entry i holds i + 1, so the output tells how
+// many entries apart the two fetches landed and 0 is a masked pixel.
+// Linear stepping is integer and must match exactly.
+bool linearGradientConforms()
+{
+    static uint32_t table[VGradient::colorTableSize];
+    for (int i = 0; i < VGradient::colorTableSize; i++) table[i] = uint32_t(i + 1);
+
+    VSpanData data;
+    data.m11 = data.m22 = data.m33 = 1;
+    data.m12 = data.m13 = data.m21 = data.m23 = data.dx = data.dy = 0;
+    data.mGradient.mColorTable = table;
+    data.mGradient.mColorTableAlpha = false;
+
+    uint32_t ref[kLength], out[kLength];
+    Operator op;
+    const VGradient::Spread spreads[] = {VGradient::Spread::Pad, VGradient::Spread::Repeat,
+                                         VGradient::Spread::Reflect};
+    for (VGradient::Spread spread : spreads) {
+        data.mGradient.mSpread = spread;
+        // starts before x1 and runs past x2 a few times
+        data.mGradient.linear = {10, 3, 31, 9};
+        getLinearGradientValues(&op.linear, &data);
+        for (int len : {kLength, 3, 8}) {
+            for (int x : {-40, 0, 7}) {
+                memset(ref, 0, sizeof(ref));
+                memset(out, 0, sizeof(out));
+                fetchLinearGradient(ref, &op, &data, 5, x, len, fetchLinearFixed_C);
+                fetchLinearGradient(out, &op, &data, 5, x, len, fetchLinearFixed);
+                if (memcmp(ref, out, sizeof(ref))) {
+                    printf("  spread %d, x %d, length %d\n", int(spread), x, len);
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// Radial lanes accumulate the determinant recurrence in a different order
+// than the scalar loop and may round to the neighbouring table entry, so
+// they are allowed one entry off but must mask the same pixels.
+bool radialGradientEntries()
+{
+    static uint32_t table[VGradient::colorTableSize];
+    for (int i = 0; i < VGradient::colorTableSize; i++) table[i] = uint32_t(i + 1);
+
+    VSpanData data;
+    data.m11 = data.m22 = data.m33 = 1;
+    data.m12 = data.m13 = data.m21 = data.m23 = data.dx = data.dy = 0;
+    data.mGradient.mColorTable = table;
+    data.mGradient.mColorTableAlpha = false;
+    data.mGradient.mSpread = VGradient::Spread::Pad;
+
+    uint32_t ref[kLength], out[kLength];
+    Operator op;
+    // plain radial and a concentric extended one, neither has pixels near
+    // the mask edge
+    const VGradientData::Radial radials[] = {{30, 20, 30, 20, 25, 0}, {30, 20, 30, 20, 100, 2}};
+    for (const VGradientData::Radial &radial : radials) {
+        data.mGradient.radial = radial;
+        getRadialGradientValues(&op.radial, &data);
+        for (int len : {kLength, 3, 8}) {
+            for (int y : {0, 20, 47}) {
+                memset(ref, 0, sizeof(ref));
+                memset(out, 0, sizeof(out));
+                fetchRadialGradient(ref, &op, &data, y, -3, len, fetchRadial_C);
+                fetchRadialGradient(out, &op, &data, y, -3, len, fetchRadial);
+                for (int i = 0; i < kLength; i++) {
+                    if ((ref[i] == 0) != (out[i] == 0) || ref[i] > out[i] + 1 ||
+                        out[i] > ref[i] + 1) {
+                        printf("  radius %g, y %d, length %d, pixel %d: entry %u vs %u\n",
+                               radial.cradius, y, len, i, ref[i], out[i]);
+                        return false;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// What one entry off means in color: rotated radials with an off center
+// focal point (lottie highlight) over a real three stop table, rendered
+// output may differ from the scalar fetch by up to 2 per channel.
+bool radialGradientColors()
+{
+    constexpr int kSize = 200, kTolerance = 2;
+    static uint32_t table[VGradient::colorTableSize];
+    const VGradientStops stops = {{0.0f, VColor(255, 230, 51)},
+                                  {0.5f, VColor(26, 77, 230)},
+                                  {1.0f, VColor(230, 26, 102)}};
+    VGradientCache::instance().generateGradientColorTable(stops, 1.0f, table,
+                                                          VGradient::colorTableSize);
+
+    VSpanData data;
+    data.m13 = data.m23 = 0;
+    data.m33 = 1;
+    data.mGradient.mColorTable = table;
+    data.mGradient.mColorTableAlpha = false;
+    data.mGradient.mSpread = VGradient::Spread::Pad;
+    data.mGradient.radial = {100, 100, 130, 85, 82, 0};
+
+    uint32_t ref[kSize], out[kSize];
+    Operator op;
+    int      worst = 0;
+    for (int angle = 0; angle < 360; angle += 6) {
+        const float rad = angle * K_PI / 180;
+        data.m11 = data.m22 = std::cos(rad);
+        data.m12 = std::sin(rad);
+        data.m21 = -data.m12;
+        data.dx = 100 - 100 * data.m11 - 100 * data.m21;
+        data.dy = 100 - 100 * data.m12 - 100 * data.m22;
+        getRadialGradientValues(&op.radial, &data);
+        for (int y = 0; y < kSize; y++) {
+            fetchRadialGradient(ref, &op, &data, y, 0, kSize, fetchRadial_C);
+            fetchRadialGradient(out, &op, &data, y, 0, kSize, fetchRadial);
+            for (int i = 0; i < kSize; i++) {
+                for (int c = 0; c < 32; c += 8) {
+                    worst = std::max(worst, std::abs(int((ref[i] >> c) & 0xff) -
+                                                     int((out[i] >> c) & 0xff)));
+                }
+            }
+        }
+    }
+    printf("  max channel difference %d, allowed %d\n", worst, kTolerance);
+    return worst <= kTolerance;
+}
+
+// Pixel conversions: the unpremultiply table against the division for
+// every channel / alpha pair, then whole kernels on pixels including
+// invalid ones (channel above alpha) and transparent ones.
+bool unpremultiplyTableConforms()
+{
+    const uint32_t *recip = vUnpremultiplyTable();
+    for (uint32_t a = 1; a < 256; a++) {
+        for (uint32_t c = 0; c < 256; c++) {
+            if ((c * recip[a]) >> 16 != c * 255 / a) {
+                printf("  channel %u, alpha %u\n", c, a);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void makeStraightPixels(uint32_t *src)
+{
+    uint32_t seed = 0x9e3779b9;
+    for (int i = 0; i < kLength; i++) {
+        uint32_t a = (i % 7 == 0) ? 0 : (i % 5 == 0) ? 255 : nextRandom(seed) >> 24;
+        uint32_t limit = (i % 11 == 0) ? 255 : a;
+        src[i] = (a << 24) | (((nextRandom(seed) >> 24) * limit / 255) << 16) |
+                 (((nextRandom(seed) >> 24) * limit / 255) << 8) |
+                 ((nextRandom(seed) >> 24) * limit / 255);
+    }
+}
+
+bool lumaMatteConforms()
+{
+    uint32_t src[kLength], ref[kLength], out[kLength];
+    makeStraightPixels(src);
+    for (int len : {kLength, 3, 8}) {
+        memcpy(ref, src, sizeof(src));
+        memcpy(out, src, sizeof(src));
+        vLumaMatte_C(ref, len);
+        vLumaMatte(out, len);
+        for (int i = 0; i < kLength; i++) {
+#if defined(IMLOTTIE_NEON)
+            // multiply-add fusing, see vLumaMatte_NEON
+            const bool same = std::abs(int(ref[i] >> 24) - int(out[i] >> 24)) <= 1 &&
+                              (ref[i] & 0xffffff) == (out[i] & 0xffffff);
+#else
+            const bool same = ref[i] == out[i];
+#endif
+            if (!same) {
+                printf("  length %d, pixel %08x: %08x vs %08x\n", len, src[i], ref[i], out[i]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool premultiplyConforms()
+{
+    uint32_t src[kLength], ref[kLength], out[kLength];
+    makeStraightPixels(src);
+    for (int len : {kLength, 3, 8}) {
+        memcpy(ref, src, sizeof(src));
+        memcpy(out, src, sizeof(src));
+        vPremultiplyRGBA_C(ref, len);
+        vPremultiplyRGBA(out, size_t(len));
+        if (memcmp(ref, out, sizeof(ref))) {
+            printf("  length %d\n", len);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Box filter of whole factor shrinks: column sums over up to 16 rows, then
+// averages of nx columns, with white blocks for the largest lane sums.
+bool boxFilterConforms()
+{
+    uint32_t pixels[max_box_size][kLength];
+    const uint *rows[max_box_size];
+    uint32_t seed = 0x600dcafe;
+    for (int j = 0; j < max_box_size; j++) {
+        for (int i = 0; i < kLength; i++) pixels[j][i] = (i % 11 < 4) ? 0xffffffff : nextRandom(seed);
+        rows[j] = pixels[j];
+    }
+
+    uint64_t ref[kLength], out[kLength];
+    for (int ny : {1, 2, 3, 5, max_box_size}) {
+        for (int columns : {kLength - 1, 3, 8}) {
+            boxColumns_C(rows, ny, 1, columns, ref);
+            boxColumns(rows, ny, 1, columns, out);
+            if (memcmp(ref, out, sizeof(uint64_t) * columns)) {
+                printf("  columns of %d rows, length %d\n", ny, columns);
+                return false;
+            }
+        }
+    }
+
+    uint32_t refPixels[kLength], outPixels[kLength];
+    for (int nx : {2, 3, 5, max_box_size}) {
+        for (int ny : {1, 3, max_box_size}) {
+            const uint area = uint(nx * ny);
+            const uint recip = (65536 + area / 2) / area;
+            const int  count = (kLength - 1) / nx;
+            boxColumns_C(rows, ny, 0, count * nx, ref);
+            for (int i = 0; i < count; i++) {
+                uint64_t sum = 0;
+                for (int k = 0; k < nx; k++) sum += ref[i * nx + k];
+                refPixels[i] = box_average(sum, recip);
+            }
+            boxAverage<0>(ref, nx, count, recip, outPixels);
+            bool ok = !memcmp(refPixels, outPixels, sizeof(uint32_t) * count);
+            if (nx == 3) {
+                boxAverage<3>(ref, nx, count, recip, outPixels);
+                ok = ok && !memcmp(refPixels, outPixels, sizeof(uint32_t) * count);
+            }
+            if (!ok) {
+                printf("  average of %dx%d blocks\n", nx, ny);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+#if defined(IMLOTTIE_SSE2)
+    printf("kernels: SSE2\n");
+#elif defined(IMLOTTIE_NEON)
+    printf("kernels: NEON\n");
+#else
+    printf("kernels: scalar only, checks compare the reference with itself\n");
+#endif
+    vInitBlendFunctions();
+
+    report("blend functions", blendFunctionsConform());
+    report("memfill32", memfillConforms());
+    report("linear gradient", linearGradientConforms());
+    report("radial gradient entries", radialGradientEntries());
+    report("radial gradient colors", radialGradientColors());
+    report("unpremultiply table", unpremultiplyTableConforms());
+    report("luma matte", lumaMatteConforms());
+    report("premultiply rgba", premultiplyConforms());
+    report("box filter", boxFilterConforms());
+    return failures ? 1 : 0;
+}
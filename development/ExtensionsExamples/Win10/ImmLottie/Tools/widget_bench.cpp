@@ -0,0 +1,149 @@
+/*
+ * Widget benchmark, puts many animations on screen at once and times what
+ * the main thread spends on them every UI frame: the per widget calls of
+ * LottieAnimation() (match, render request, image lookup) and sync() that
+ * uploads ready frames to the atlas. Render thread plays them meanwhile.
+ *
+ * Build (any C++17 compiler), from ImmLottie folder:
+ *   g++ -std=c++17 -O2 -pthread -DIMLOTTIE_STANDALONE -ICore -IGUI \
+ *       Core/imottie_renderer.cpp Core/freetype/v_ft_*.cpp Tools/widget_bench.cpp -o widget_bench
+ *
+ * Usage:
+ *   widget_bench [options] [file.json...]
+ *     --anims <n>       animations on screen, default 500
+ *     --frames <n>      UI frames, default 300
+ *     --threads <n>     render workers, default picks from cpu count
+ *   Without files a generated spinner is used, every widget gets its own
+ *   size so each one is a separate animation.
+ */
+
+#include "imgui_headless.h"
+#include "imlottie.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    int anims = 500;
+    int frames = 300;
+    int threads = -1;
+    std::vector<std::string> files;
+};
+
+void usage() {
+    printf("usage: widget_bench [--anims n] [--frames n] [--threads n] [file.json...]\n");
+}
+
+bool parseArgs(int argc, char **argv, Options &opt) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--anims" && hasValue) {
+            opt.anims = atoi(argv[++i]);
+        } else if (arg == "--frames" && hasValue) {
+            opt.frames = atoi(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            opt.threads = atoi(argv[++i]);
+        } else if (arg[0] != '-') {
+            opt.files.push_back(arg);
+        } else {
+            return false;
+        }
+    }
+    return opt.anims > 0 && opt.frames > 0;
+}
+
+// arc turning once a second, like a loading spinner
+std::string spinner() {
+    return "{\"v\":\"5.5.2\",\"fr\":30,\"ip\":0,\"op\":30,\"w\":48,\"h\":48,\"nm\":\"spinner\",\"ddd\":0,"
+           "\"assets\":[],\"layers\":[{\"ddd\":0,\"ind\":1,\"ty\":4,\"nm\":\"arc\",\"sr\":1,\"ks\":{"
+           "\"o\":{\"a\":0,\"k\":100},\"r\":{\"a\":1,\"k\":[{\"i\":{\"x\":1,\"y\":1},\"o\":{\"x\":0,\"y\":0},"
+           "\"t\":0,\"s\":[0],\"e\":[360]},{\"t\":30}]},\"p\":{\"a\":0,\"k\":[24,24,0]},"
+           "\"a\":{\"a\":0,\"k\":[0,0,0]},\"s\":{\"a\":0,\"k\":[100,100,100]}},\"ao\":0,\"shapes\":["
+           "{\"ty\":\"gr\",\"it\":[{\"ty\":\"el\",\"d\":1,\"s\":{\"a\":0,\"k\":[36,36]},\"p\":{\"a\":0,\"k\":[0,0]}},"
+           "{\"ty\":\"tm\",\"s\":{\"a\":0,\"k\":0},\"e\":{\"a\":0,\"k\":70},\"o\":{\"a\":0,\"k\":0},\"m\":1},"
+           "{\"ty\":\"st\",\"c\":{\"a\":0,\"k\":[0.2,0.6,1,1]},\"o\":{\"a\":0,\"k\":100},\"w\":{\"a\":0,\"k\":5},"
+           "\"lc\":2,\"lj\":2},{\"ty\":\"tr\",\"p\":{\"a\":0,\"k\":[0,0]},\"a\":{\"a\":0,\"k\":[0,0]},"
+           "\"s\":{\"a\":0,\"k\":[100,100]},\"r\":{\"a\":0,\"k\":0},\"o\":{\"a\":0,\"k\":100}}]}],"
+           "\"ip\":0,\"op\":30,\"st\":0,\"bm\":0}]}";
+}
+
+double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options opt;
+    if (!parseArgs(argc, argv, opt)) {
+        usage();
+        return 2;
+    }
+
+    std::string generated;
+    if (opt.files.empty()) {
+        generated = (std::filesystem::temp_directory_path() / "widget_bench.json").string();
+        std::ofstream(generated) << spinner();
+        opt.files.push_back(generated);
+    }
+
+    ImLottie::init(opt.threads);
+    auto *renderer = ImLottie::detail::g_lottieRenderer;
+
+    std::vector<double> widgetMs, syncMs;
+    size_t textures = 0;
+    for (int ui = 0; ui < opt.frames; ui++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < opt.anims; i++) {
+            // same calls LottieAnimation() makes for a visible widget
+            const int w = 32 + i % 50, h = 32 + i / 50 % 50;
+            const char *path = opt.files[i % opt.files.size()].c_str();
+            ImGuiID pid = renderer->match(path, w, h, true, 0);
+            renderer->render(pid);
+            ImVec2 uv0, uv1;
+            if (renderer->image(pid, uv0, uv1)) {
+                textures++;
+            }
+        }
+        widgetMs.push_back(msSince(start));
+
+        start = std::chrono::steady_clock::now();
+        ImLottie::sync();
+        syncMs.push_back(msSince(start));
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+
+    const size_t pages = renderer->atlas.pageCount();
+    ImLottie::destroy();
+    if (!generated.empty()) {
+        std::filesystem::remove(generated);
+    }
+
+    // first frames load animations, steady state is what counts
+    auto report = [] (const char *name, std::vector<double> &ms) {
+        std::vector<double> steady(ms.begin() + ms.size() / 4, ms.end());
+        double sum = 0;
+        for (double v : steady) {
+            sum += v;
+        }
+        std::sort(steady.begin(), steady.end());
+        printf("%-8s avg %.3f ms, p95 %.3f ms, max %.3f ms per UI frame\n", name, sum / steady.size(),
+               steady[steady.size() * 95 / 100], steady.back());
+    };
+    printf("%d animations, %d UI frames, %zu atlas pages, %.1f%% widgets had a frame\n", opt.anims, opt.frames,
+           pages, 100.0 * textures / (double(opt.anims) * opt.frames));
+    report("widgets", widgetMs);
+    report("sync", syncMs);
+    return 0;
+}